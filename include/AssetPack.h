@@ -0,0 +1,120 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Texture.h>
+
+/**
+ * @brief A binary file of textures stored in their final form, mapped read-only and used without copying.
+ *
+ * The file starts with a header and a table of entries, followed by the pixels of every texture: its stored shade
+ * levels one after the other, in its layout, so that a texture only points to its pixels in the mapping. The pixels of
+ * every texture start on a cache line. The textures keep the pack alive as long as they use it.
+ */
+class AssetPack : public std::enable_shared_from_this<AssetPack>
+{
+public:
+    /**
+     * @brief Maps an asset pack.
+     *
+     * @param path The path to the pack.
+     * @return The mapped pack.
+     * @throws std::runtime_error If the file cannot be mapped or is not a valid pack.
+     */
+    static std::shared_ptr<AssetPack> open(const std::string &path);
+
+    /**
+     * @brief Writes textures to an asset pack, in their layout and with their stored shade levels.
+     *
+     * @param path The path to the pack.
+     * @param textures The names of the textures (at most 31 characters) and the textures (not indexed).
+     * @throws std::runtime_error If the file cannot be written.
+     * @throws std::invalid_argument If a name is too long or a texture is indexed.
+     */
+    static void write(const std::string &path, const std::vector<std::pair<std::string, const Texture *>> &textures);
+
+    /**
+     * @brief Unmaps the pack.
+     */
+    ~AssetPack();
+
+    /**
+     * @brief Checks if the pack contains a texture.
+     *
+     * @param name The name of the texture.
+     * @return True if the pack contains the texture, false otherwise.
+     */
+    bool has(const std::string &name) const;
+
+    /**
+     * @brief Gets a texture of the pack. Its pixels are used in place.
+     *
+     * @param name The name of the texture.
+     * @return The texture.
+     * @throws std::invalid_argument If the pack does not contain the texture.
+     */
+    Texture getTexture(const std::string &name) const;
+
+    /**
+     * @brief Gets the size of the mapped file.
+     *
+     * @return The size of the pack in bytes.
+     */
+    size_t getSize() const;
+
+private:
+    /**
+     * @brief An entry of the table of the pack, as stored in the file.
+     */
+    struct Entry
+    {
+        char name[32];   // The name of the texture, terminated by a null character.
+        uint32_t width;  // The width of the texture.
+        uint32_t height; // The height of the texture.
+        uint32_t layout; // The layout of the texture (a TextureLayout).
+        uint32_t shades; // The number of shade levels stored.
+        uint64_t offset; // The position of the pixels in the file.
+        uint64_t size;   // The size of the pixels in bytes.
+    };
+
+    /**
+     * @brief The header of the pack, as stored in the file (followed by the entries).
+     */
+    struct Header
+    {
+        char magic[4];    // "RCPK".
+        uint32_t version; // The version of the format.
+        uint32_t count;   // The number of entries.
+        uint32_t padding; // Unused (0).
+    };
+
+    static const uint32_t version = 2;  // The version of the format written.
+    static const size_t alignment = 64; // The alignment of the pixels of every texture in the file.
+
+    const unsigned char *data; // The mapped file.
+    size_t size;               // The size of the mapped file.
+    const Entry *entries;      // The table of the entries, in the mapping.
+    uint32_t count;            // The number of entries.
+
+    /**
+     * @brief Maps and validates an asset pack.
+     *
+     * @param path The path to the pack.
+     */
+    AssetPack(const std::string &path);
+
+    /**
+     * @brief Finds an entry of the table.
+     *
+     * @param name The name of the texture.
+     * @return The entry, or NULL if the pack does not contain the texture.
+     */
+    const Entry *find(const std::string &name) const;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <vector>
+
+/**
+ * @brief A min/max pyramid over the zBuffer, giving the nearest and farthest wall over any range of columns in
+ * logarithmic time. Level 0 is the zBuffer, and every entry of the next level covers two entries of the previous one.
+ */
+class DepthPyramid
+{
+public:
+    /**
+     * @brief Constructs a DepthPyramid object for the specified number of columns.
+     *
+     * @param width The number of columns.
+     */
+    DepthPyramid(int width);
+
+    /**
+     * @brief Builds the pyramid from the distances of the walls.
+     *
+     * @param zBuffer The distance of the wall of every column.
+     */
+    void build(const std::vector<double> &zBuffer);
+
+    /**
+     * @brief Gets the nearest and farthest walls over a range of columns.
+     *
+     * @param start The first column of the range.
+     * @param end The column after the last one of the range.
+     * @param minDepth The distance of the nearest wall of the range.
+     * @param maxDepth The distance of the farthest wall of the range.
+     */
+    void range(int start, int end, double &minDepth, double &maxDepth) const;
+
+private:
+    std::vector<int> offsets;       // The offset of every level in the arrays below.
+    std::vector<int> sizes;         // The number of entries of every level.
+    std::vector<double> minDepths;  // The nearest wall of every entry, level after level.
+    std::vector<double> maxDepths;  // The farthest wall of every entry, level after level.
+};
+
+#endif
@@ -4,7 +4,12 @@
 #include <vector>
 
 #include <Texture.h>
+#include <AssetPack.h>
+#include <TextureCache.h>
 #include <Sprite.h>
+#include <SpritePool.h>
+#include <OpaqueSpans.h>
+#include <SpriteGrid.h>
 
 /**
  * @brief Represents a game map.
@@ -20,13 +25,17 @@ public:
      * @param floorTexture The texture for the floor.
      * @param ceilingTexture The texture for the ceiling.
      * @param textures The list of textures for the walls.
+     * @param spriteTextures The list of textures for the sprites.
      * @param sprites The list of sprites in the map.
+     * @param spriteCapacity The maximum number of sprites in the map.
      */
     Map(int width, int height,
         const Texture &floorTexture,
         const Texture &ceilingTexture,
         std::initializer_list<Texture> textures,
-        std::vector<Sprite> &sprites);
+        std::initializer_list<Texture> spriteTextures,
+        const std::vector<Sprite> &sprites,
+        int spriteCapacity);
 
     /**
      * @brief Gets the value at the specified position in the map.
@@ -37,6 +46,20 @@ public:
      */
     int get(int x, int y) const;
 
+    /**
+     * @brief Gets the width of the map.
+     *
+     * @return The width of the map.
+     */
+    int getWidth() const;
+
+    /**
+     * @brief Gets the height of the map.
+     *
+     * @return The height of the map.
+     */
+    int getHeight() const;
+
     /**
      * @brief Gets the floor texture of the map.
      *
@@ -52,11 +75,86 @@ public:
     const Texture &getCeilingTexture() const;
 
     /**
-     * @brief Gets the list of sprites in the map.
+     * @brief Gets the sprites in the map.
      *
-     * @return The list of sprites.
+     * @return The pool of the sprites.
      */
-    const std::vector<Sprite> &getSprites() const;
+    const SpritePool &getSprites() const;
+
+    /**
+     * @brief Gets the spatial index of the sprites in the map, by sprite id.
+     *
+     * @return The grid of the sprites.
+     */
+    const SpriteGrid &getSpriteGrid() const;
+
+    /**
+     * @brief Gets the texture of a sprite.
+     *
+     * @param textureId The index of the texture of the sprite.
+     * @return The texture of the sprite.
+     */
+    const Texture &getSpriteTexture(int textureId) const;
+
+    /**
+     * @brief Gets the opaque runs of the columns of a sprite texture.
+     *
+     * @param textureId The index of the texture of the sprite.
+     * @return The opaque runs of the texture.
+     */
+    const OpaqueSpans &getSpriteSpans(int textureId) const;
+
+    /**
+     * @brief Adds a sprite to the map.
+     *
+     * @param x The x-coordinate of the sprite.
+     * @param y The y-coordinate of the sprite.
+     * @param textureId The index of the texture of the sprite.
+     * @return The id of the sprite.
+     */
+    int addSprite(double x, double y, int textureId);
+
+    /**
+     * @brief Removes a sprite from the map.
+     *
+     * @param id The id of the sprite.
+     */
+    void removeSprite(int id);
+
+    /**
+     * @brief Moves a sprite of the map.
+     *
+     * @param id The id of the sprite.
+     * @param x The x-coordinate of the new position.
+     * @param y The y-coordinate of the new position.
+     */
+    void moveSprite(int id, double x, double y);
+
+    /**
+     * @brief Changes the order in which the texels of the textures of the map are stored, by usage.
+     *
+     * @param walls The layout of the textures of the walls.
+     * @param floorCeiling The layout of the textures of the floor and ceiling.
+     * @param sprites The layout of the textures of the sprites.
+     */
+    void setTextureLayouts(TextureLayout walls, TextureLayout floorCeiling, TextureLayout sprites);
+
+    /**
+     * @brief Converts all the textures of the map (walls, floor, ceiling and sprites) to indexed colors.
+     */
+    void palettizeTextures();
+
+    /**
+     * @brief Converts all the textures of the map to RGB565, for the 16-bit framebuffers (see Texture::prepareRGB565).
+     */
+    void prepareTexturesRGB565();
+
+    /**
+     * @brief Gets the memory taken by the pixels of all the textures of the map.
+     *
+     * @return The size of the pixels in bytes.
+     */
+    size_t getTexturesMemorySize() const;
 
     /**
      * @brief Checks if there is a wall at the specified position in the map.
@@ -78,6 +176,7 @@ public:
 
     /**
      * @brief Moves the sprite of the player at the specified index to the specified position.
+     * The sprite of a player is hidden until its first move.
      *
      * @param index The index of the player.
      * @param x The x-coordinate of the position.
@@ -93,12 +192,53 @@ public:
      */
     static Map generateMap(int nbPlayers);
 
+    /**
+     * @brief Generates a map with the specified number of players, with the textures of an asset pack.
+     * The textures use the pixels of the pack in place (see writeAssetPack).
+     *
+     * @param nbPlayers The number of players.
+     * @param pack The asset pack with the textures of the map, or NULL to use the built-in textures.
+     * @return The generated map.
+     */
+    static Map generateMap(int nbPlayers, const AssetPack *pack);
+
+    /**
+     * @brief Writes the textures of the map to an asset pack, as they are used (layouts and shade levels).
+     *
+     * @param path The path to the pack.
+     */
+    void writeAssetPack(const std::string &path) const;
+
+    /**
+     * @brief Gets the names of the textures of the walls in an asset pack written by writeAssetPack, by index.
+     *
+     * @return The names of the textures of the walls.
+     */
+    std::vector<std::string> getWallTextureNames() const;
+
+    /**
+     * @brief Serves the textures of the walls from a cache of the textures named by getWallTextureNames, instead of
+     * keeping them all. The textures of the walls of the map are released, and the conversions of the textures of the
+     * map are applied to the cache. The names of the textures of the walls are kept.
+     *
+     * @param cache The texture cache, which must outlive the use of the map.
+     */
+    void setTextureCache(TextureCache *cache);
+
+    static const int maxSprites = 1 << 16;      // The maximum number of sprites in a generated map.
+    static constexpr double spriteCellSize = 2; // The size of the cells of the spatial index of the sprites.
+
 private:
     int width, height;                    // The width and height of the map.
     std::vector<int> map;                 // The map data.
-    std::vector<Sprite> sprites;          // The list of sprites in the map.
+    SpritePool sprites;                   // The sprites in the map.
+    SpriteGrid spriteGrid;                // The spatial index of the sprites, kept in sync with the pool.
+    std::vector<Texture> spriteTextures;  // The list of textures for the sprites.
+    std::vector<OpaqueSpans> spriteSpans; // The opaque runs of the textures for the sprites.
     std::vector<Texture> textures;        // The list of textures for the walls.
+    int nbWallTextures;                   // The number of textures for the walls, kept when a cache serves them.
     Texture floorTexture, ceilingTexture; // The textures for the floor and ceiling.
+    TextureCache *textureCache;           // The cache serving the textures for the walls (NULL if they are all kept).
 };
 
 #endif
\ No newline at end of file
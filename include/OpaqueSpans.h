@@ -0,0 +1,53 @@
+#ifndef OPAQUESPANS_H
+#define OPAQUESPANS_H
+
+#include <vector>
+
+#include <Texture.h>
+
+/**
+ * @brief Represents a run of consecutive opaque texels in a column of a texture.
+ */
+struct OpaqueSpan
+{
+    int start, end; // The range [start, end) of the rows of the run.
+};
+
+/**
+ * @brief The OpaqueSpans class lists the opaque runs of every column of a sprite texture.
+ *
+ * Black is the invisible color of the sprites: the rasterizer skips the transparent gaps between the runs, and fills
+ * the runs without testing the texels.
+ */
+class OpaqueSpans
+{
+public:
+    /**
+     * @brief Constructs an OpaqueSpans object by scanning the columns of the specified texture.
+     *
+     * @param texture The texture to scan.
+     */
+    OpaqueSpans(const Texture &texture);
+
+    /**
+     * @brief Gets the opaque runs of a column, from top to bottom.
+     *
+     * @param x The column of the texture.
+     * @return A pointer to the first run of the column.
+     */
+    const OpaqueSpan *get(int x) const;
+
+    /**
+     * @brief Gets the number of opaque runs of a column.
+     *
+     * @param x The column of the texture.
+     * @return The number of runs.
+     */
+    int count(int x) const;
+
+private:
+    std::vector<OpaqueSpan> spans; // The runs of all the columns, column after column.
+    std::vector<int> offsets;      // The index of the first run of every column, followed by the total number of runs.
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PEERTABLE_H
+#define PEERTABLE_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <PositionPacket.h>
+
+/**
+ * @brief Counters of the packets accepted and dropped by a PeerTable.
+ */
+struct PeerStats
+{
+    long accepted = 0;  // The number of packets accepted.
+    long malformed = 0; // The number of datagrams that are not packets of the protocol.
+    long stale = 0;     // The number of packets older than, or duplicates of, a packet already accepted from the sender.
+    long restarts = 0;  // The number of times a sender was found to restart its sequence numbers.
+    long peers = 0;     // The number of entities given a player index.
+};
+
+/**
+ * @brief Writes a summary of the counters of a peer table.
+ * @param os The stream to write to.
+ * @param stats The counters of the table.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const PeerStats &stats);
+
+/**
+ * @brief Tracks the other players by id: the last sequence number received from every sender, to drop the stale
+ * packets, and the player index of every entity.
+ *
+ * A sender that restarts numbers its packets from 0 again: a packet far behind the last one accepted (by more than
+ * restartWindow packets), or sent later than it by the clock of the sender, starts a new sequence rather than being
+ * dropped.
+ *
+ * The state is held in tables indexed by id (the ids are 16-bit), so that a lookup is a single array access and never
+ * allocates.
+ */
+class PeerTable
+{
+public:
+    /**
+     * @brief Constructs a PeerTable object.
+     *
+     * @param players The number of player indexes to give out, the entities being given the indexes in the order they
+     * are first received (cycling when there are more entities than indexes).
+     * @param localId The id of the local player, whose updates are ignored.
+     */
+    PeerTable(int players, int localId);
+
+    /**
+     * @brief Decodes a datagram and accepts it if it is newer than every packet already accepted from its sender, or
+     * comes from a sender that restarted.
+     *
+     * @param data The datagram.
+     * @param length The size of the datagram in bytes.
+     * @param packet The packet to decode the datagram into.
+     * @return true if the packet is accepted, false if it is malformed or stale.
+     */
+    bool accept(const unsigned char *data, int length, PositionPacket &packet);
+
+    /**
+     * @brief Gets the player index of an entity, giving it the next index the first time.
+     *
+     * @param id The id of the entity.
+     * @return The index of the player, or -1 for the local player (or if there are no indexes to give out).
+     */
+    int getIndex(int id);
+
+    /**
+     * @brief Gets the counters of the table.
+     *
+     * @return The counters since the creation of the table.
+     */
+    const PeerStats &getStats() const;
+
+    static const int maxIds = 65536;       // The number of ids of the protocol.
+    static const int restartWindow = 1024; // The largest reordering of the packets of a sender, beyond which it restarted.
+
+private:
+    int players;                      // The number of player indexes to give out.
+    int localId;                      // The id of the local player.
+    int nextIndex;                    // The index given to the next new entity.
+    std::vector<int> indexes;         // The player index of every entity, by id (-1 if none yet).
+    std::vector<uint32_t> sequences;  // The last sequence number accepted from every sender, by id.
+    std::vector<uint32_t> timestamps; // The timestamp of the last packet accepted from every sender, by id.
+    std::vector<bool> heard;          // Whether a packet was accepted from every sender, by id.
+    PeerStats stats;                  // The counters of the table.
+};
+
+#endif
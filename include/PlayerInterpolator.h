@@ -0,0 +1,84 @@
+#ifndef PLAYERINTERPOLATOR_H
+#define PLAYERINTERPOLATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include <PlayerSnapshots.h>
+
+/**
+ * @brief Smooths the motion of the remote players between the states received from them.
+ *
+ * Every player keeps a short history of its states, timestamped by its sender. The offset between the clock of the
+ * sender and the local clock is estimated as the smallest difference between the arrival time and the timestamp of
+ * the states in the history (the state that travelled the fastest). A player is then drawn where it was a fixed delay
+ * ago on the clock of its sender, interpolated between the two states around that time, or extrapolated from the last
+ * two states for a short while when no newer state arrived in time.
+ */
+class PlayerInterpolator
+{
+public:
+    /**
+     * @brief Constructs a PlayerInterpolator object, no state being received yet.
+     *
+     * @param players The number of remote players.
+     * @param delay How far in the past the players are drawn, in milliseconds (0 to draw the last state received).
+     */
+    PlayerInterpolator(int players, int delay);
+
+    /**
+     * @brief Adds the states of a snapshot that are newer than the last ones of their player to the histories.
+     *
+     * @param states The states of the players, by index.
+     */
+    void update(const std::vector<PlayerState> &states);
+
+    /**
+     * @brief Gets the position to draw a player at.
+     *
+     * @param index The index of the player.
+     * @param now The local time of the frame, in milliseconds (see PositionPacket::now).
+     * @param x The x-coordinate of the player.
+     * @param y The y-coordinate of the player.
+     * @return false if no state of the player was received (the position is not set), true otherwise.
+     */
+    bool getPosition(int index, uint32_t now, double &x, double &y) const;
+
+    static const int historySize = 16;       // The number of states kept per player.
+    static const int maxExtrapolation = 200; // The longest extrapolation past the last state, in milliseconds.
+
+private:
+    /**
+     * @brief A state in the history of a player.
+     */
+    struct Sample
+    {
+        double x, y;        // The position of the player.
+        uint32_t timestamp; // The time the state was sent, on the clock of the sender.
+        uint32_t offset;    // The arrival time on the local clock minus the timestamp.
+    };
+
+    /**
+     * @brief The recent states of a player, in a ring.
+     */
+    struct History
+    {
+        Sample samples[historySize]; // The states, the newest one before next.
+        int next = 0;                // The index of the next state written.
+        int count = 0;               // The number of states.
+        uint32_t offset = 0;         // The estimated offset from the clock of the sender to the local clock.
+
+        /**
+         * @brief Gets a state counting back from the newest.
+         *
+         * @param age The number of newer states, in [0, count).
+         * @return The state.
+         */
+        const Sample &back(int age) const;
+    };
+
+    int delay;                      // How far in the past the players are drawn, in milliseconds.
+    std::vector<History> histories; // The history of every player, by index.
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PLAYERSNAPSHOTS_H
+#define PLAYERSNAPSHOTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The last state received of a remote player.
+ */
+struct PlayerState
+{
+    int id = -1;            // The id of the player in the packets.
+    double x = 0, y = 0;    // The position of the player.
+    double direction = 0;   // The angle of the direction of the player, in radians.
+    uint32_t timestamp = 0; // The time the state was sent, on the clock of the sender, in milliseconds.
+    uint32_t arrival = 0;   // The time the state was received, on the local clock, in milliseconds.
+    bool received = false;  // Whether a state of the player was received (the player is hidden until then).
+};
+
+/**
+ * @brief Hands the states of the remote players over from the network thread to the renderer, without locks.
+ *
+ * The snapshots are triple-buffered: the network thread fills a back buffer and publishes it by swapping it with the
+ * middle buffer, and the renderer takes the latest snapshot by swapping its front buffer with the middle one if it was
+ * published since. Both swaps are a single atomic exchange, so that neither side ever waits for the other, and the
+ * renderer always sees the states of all the players from the same publication.
+ */
+class PlayerSnapshots
+{
+public:
+    /**
+     * @brief Constructs a PlayerSnapshots object, no state being received yet.
+     *
+     * @param players The number of remote players.
+     */
+    PlayerSnapshots(int players);
+
+    /**
+     * @brief Updates the state of a player, published with the next call to publish (network thread only).
+     *
+     * @param index The index of the player.
+     * @param state The state of the player.
+     */
+    void set(int index, const PlayerState &state);
+
+    /**
+     * @brief Publishes the states of all the players (network thread only).
+     */
+    void publish();
+
+    /**
+     * @brief Takes the latest published snapshot, if any was published since the last call (renderer only).
+     *
+     * @return true if a new snapshot was taken, false if the current one is still the latest.
+     */
+    bool acquire();
+
+    /**
+     * @brief Gets the snapshot taken by the last call to acquire (renderer only).
+     *
+     * @return The states of the players, by index.
+     */
+    const std::vector<PlayerState> &getSnapshot() const;
+
+private:
+    static const int published = 4; // The flag of the middle buffer set when it holds a snapshot not taken yet.
+
+    std::vector<PlayerState> states;     // The states being updated by the network thread.
+    std::vector<PlayerState> buffers[3]; // The back, middle and front buffers, in no fixed order.
+    int back;                            // The index of the buffer filled by the network thread.
+    std::atomic<int> middle;             // The index of the middle buffer, with the published flag.
+    int front;                           // The index of the buffer read by the renderer.
+};
+
+#endif
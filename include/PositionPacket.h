@@ -0,0 +1,139 @@
+#ifndef POSITIONPACKET_H
+#define POSITIONPACKET_H
+
+#include <cstdint>
+
+/**
+ * @brief The position and direction of an entity (a player), as carried by a PositionPacket.
+ */
+struct EntityUpdate
+{
+    int id;           // The id of the entity, in [0, 65535].
+    double x, y;      // The position of the entity.
+    double direction; // The angle of the direction of the entity, in radians.
+};
+
+/**
+ * @brief A datagram of the wire protocol between the players, holding the updates of several entities.
+ *
+ * The packet is encoded in network byte order: a 12-byte header (version, number of updates, id of the sender,
+ * sequence number, timestamp in milliseconds) followed by 12 bytes per update (entity id, direction quantized to
+ * 1/65536 of a turn, x and y in 16.16 fixed point). The sender numbers its packets so that the receivers can drop
+ * the stale ones.
+ */
+class PositionPacket
+{
+public:
+    /**
+     * @brief Constructs an empty PositionPacket object, to decode a datagram into.
+     */
+    PositionPacket();
+
+    /**
+     * @brief Constructs a PositionPacket object without updates.
+     *
+     * @param sender The id of the sender, in [0, 65535].
+     * @param sequence The sequence number of the packet, incremented by the sender for every packet.
+     * @param timestamp The time the packet is sent, in milliseconds (see now).
+     */
+    PositionPacket(int sender, uint32_t sequence, uint32_t timestamp);
+
+    /**
+     * @brief Adds the update of an entity to the packet.
+     *
+     * @param update The update, whose id is in [0, 65535] and position in [-32768, 32768).
+     * @return false if the packet is full (the update is not added), true otherwise.
+     */
+    bool add(const EntityUpdate &update);
+
+    /**
+     * @brief Encodes the packet.
+     *
+     * @param buffer The buffer to write to, at least getSize() bytes long.
+     * @return The number of bytes written.
+     */
+    int encode(unsigned char *buffer) const;
+
+    /**
+     * @brief Encodes the header of the packet with another sequence number, to send the same updates to receivers
+     * numbering the packets of the sender differently.
+     *
+     * @param buffer The buffer to write to, at least headerSize bytes long.
+     * @param sequence The sequence number written instead of the one of the packet.
+     */
+    void encodeHeader(unsigned char *buffer, uint32_t sequence) const;
+
+    /**
+     * @brief Decodes a datagram, without allocating.
+     *
+     * @param data The datagram.
+     * @param length The size of the datagram in bytes.
+     * @return false if the datagram is not a packet of this version of the protocol, true otherwise.
+     */
+    bool decode(const unsigned char *data, int length);
+
+    /**
+     * @brief Gets the id of the sender.
+     *
+     * @return The id of the sender.
+     */
+    int getSender() const;
+
+    /**
+     * @brief Gets the sequence number of the packet.
+     *
+     * @return The sequence number.
+     */
+    uint32_t getSequence() const;
+
+    /**
+     * @brief Gets the time the packet was sent, on the clock of the sender.
+     *
+     * @return The timestamp in milliseconds.
+     */
+    uint32_t getTimestamp() const;
+
+    /**
+     * @brief Gets the number of updates of the packet.
+     *
+     * @return The number of updates.
+     */
+    int getCount() const;
+
+    /**
+     * @brief Gets an update of the packet, quantized as it is sent.
+     *
+     * @param i The index of the update, in [0, getCount()).
+     * @return The update.
+     */
+    const EntityUpdate &getUpdate(int i) const;
+
+    /**
+     * @brief Gets the size of the encoded packet.
+     *
+     * @return The size in bytes.
+     */
+    int getSize() const;
+
+    /**
+     * @brief Gets the current time for the timestamps (a monotonic clock, wrapping every 49 days).
+     *
+     * @return The time in milliseconds.
+     */
+    static uint32_t now();
+
+    static const int version = 1;                                    // The version of the protocol.
+    static const int headerSize = 12;                                // The size of the header in bytes.
+    static const int updateSize = 12;                                // The size of an update in bytes.
+    static const int maxUpdates = (1472 - headerSize) / updateSize;  // The most updates fitting in 1472 bytes (see UDPReceiver).
+    static const int maxSize = headerSize + maxUpdates * updateSize; // The size of a full packet in bytes.
+
+private:
+    int sender;                       // The id of the sender.
+    uint32_t sequence;                // The sequence number of the packet.
+    uint32_t timestamp;               // The time the packet was sent, in milliseconds.
+    int count;                        // The number of updates.
+    EntityUpdate updates[maxUpdates]; // The updates, quantized.
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef POSITIONRECEIVER_H
+#define POSITIONRECEIVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <PeerTable.h>
+#include <PlayerSnapshots.h>
+#include <PositionPacket.h>
+#include <UDPReceiver.h>
+
+/**
+ * @brief Counters of the positions taken in by a PositionReceiver.
+ */
+struct PositionReceiveStats
+{
+    long packets = 0;            // The number of packets accepted.
+    long updates = 0;            // The number of positions in the packets accepted.
+    long lost = 0;               // The number of packets missing from the sequences of their senders.
+    std::vector<long> latencies; // The number of packets accepted per latency from their timestamp (ms), up to maxLatency.
+};
+
+/**
+ * @brief Takes in the positions of the other players from a transport: the packets received are decoded, filtered by
+ * the table of the peers, and their positions handed over to the triple buffer of the players, a batch at a time.
+ *
+ * The receiver runs on a thread of its own, the only one that updates the table and the snapshots. When it measures,
+ * it also counts the packets accepted, their latency and the gaps in the sequences of their senders: the counters are
+ * written by the receiving thread only, and can be read from any thread while it runs.
+ */
+class PositionReceiver
+{
+public:
+    /**
+     * @brief Constructs a PositionReceiver object.
+     *
+     * @param peers The table of the peers of the transport.
+     * @param snapshots The snapshots the positions are handed over to.
+     * @param measure Whether to count the packets accepted, their latency and the packets lost.
+     */
+    PositionReceiver(PeerTable &peers, PlayerSnapshots &snapshots, bool measure);
+
+    /**
+     * @brief Receives the positions until the game stops (the body of the receiving thread).
+     *
+     * @param receiver The transport, a UDPReceiver or a SharedMemoryReceiver.
+     * @param isRunning Whether the game still runs, checked at least every 100 ms.
+     */
+    template <typename Receiver>
+    void run(Receiver *receiver, const std::atomic<bool> *isRunning);
+
+    /**
+     * @brief Gets the counters of the receiver (all 0 unless it measures).
+     *
+     * @return The counters since the creation of the receiver.
+     */
+    PositionReceiveStats getStats() const;
+
+    static const int maxLatency = 1000; // The largest latency counted on its own (ms), the longer ones being counted as it.
+
+private:
+    PeerTable &peers;                         // The table of the peers of the transport.
+    PlayerSnapshots &snapshots;               // The snapshots the positions are handed over to.
+    bool measure;                             // Whether the packets are counted.
+    PositionPacket packet;                    // The packet being decoded.
+    std::vector<uint32_t> lastSequences;      // The sequence number of the last packet accepted from every sender, by id.
+    std::vector<bool> seen;                   // Whether a packet was accepted from every sender, by id.
+    std::atomic<long> packets, updates, lost; // The counters of the packets accepted.
+    std::vector<std::atomic<long>> latencies; // The number of packets accepted per latency (ms).
+
+    /**
+     * @brief Decodes a packet and sets the positions it holds, if the table of the peers accepts it.
+     *
+     * @param received The packet.
+     * @param arrival The time the batch of the packet was received (ms).
+     * @return true if a position was set.
+     */
+    bool handle(const ReceivedPacket &received, uint32_t arrival);
+};
+
+template <typename Receiver>
+void PositionReceiver::run(Receiver *receiver, const std::atomic<bool> *isRunning)
+{
+    while (isRunning->load())
+    {
+        // sleep until packets arrive, waking up regularly to check that the game is still running
+        int count = receiver->receive(100);
+        if (count == 0)
+            continue;
+        uint32_t arrival = PositionPacket::now();
+        bool updated = false;
+        for (int i = 0; i < count; i++)
+            if (handle(receiver->getPacket(i), arrival))
+                updated = true;
+        // the renderer takes the states of the whole batch at once
+        if (updated)
+            snapshots.publish();
+    }
+}
+
+#endif
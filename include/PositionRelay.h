@@ -0,0 +1,132 @@
+#ifndef POSITIONRELAY_H
+#define POSITIONRELAY_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <PeerTable.h>
+#include <PositionPacket.h>
+#include <PotentiallyVisibleSet.h>
+#include <UDPFanoutSender.h>
+#include <UDPReceiver.h>
+
+/**
+ * @brief Counters of the packets received and sent by a PositionRelay.
+ */
+struct RelayStats
+{
+    long received = 0;    // The number of packets accepted from the players.
+    long updates = 0;     // The number of entity updates accepted.
+    long ticks = 0;       // The number of ticks that sent a snapshot.
+    long sent = 0;        // The number of datagrams sent to the subscribers.
+    long meshPackets = 0; // The number of datagrams the players would have sent to each other without the relay.
+    long forwarded = 0;   // The number of updates sent to the subscribers, counted once per subscriber.
+    long unfiltered = 0;  // The number of updates that would have been sent to the subscribers without a visible set.
+    double seconds = 0;   // The time since the relay started.
+};
+
+/**
+ * @brief Writes a summary of the counters of a relay.
+ * @param os The stream to write to.
+ * @param stats The counters of the relay.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const RelayStats &stats);
+
+/**
+ * @brief Relays the positions of the players in a star: every player sends its updates to the relay only, and the
+ * relay sends the updates received during a tick to all the subscribers, combined in as few packets as possible.
+ *
+ * With N players, the players send N datagrams per round of updates and the relay N per tick (for up to 121 updated
+ * players), instead of N * (N - 1) datagrams when every player sends to every other one.
+ */
+class PositionRelay
+{
+public:
+    /**
+     * @brief Constructs a PositionRelay object listening on a port.
+     *
+     * @param port The port to receive the updates on (0 for any free port).
+     * @param subscribers The IP addresses and ports of the players to send the snapshots to.
+     * @param id The id of the relay, as the sender of the snapshots.
+     * @param tick The time between two snapshots, in milliseconds.
+     */
+    PositionRelay(int port, const std::vector<std::pair<std::string, int>> &subscribers, int id, int tick);
+
+    /**
+     * @brief Sends the updates to the subscribers who can possibly see the updated players only, every subscriber
+     * receiving all the positions at a lower rate in background. The subscribers whose position is not known yet
+     * receive all the updates.
+     *
+     * @param pvs The potentially visible set of the map, which must outlive the relay (NULL to send all the updates to
+     * all the subscribers).
+     * @param ids The ids of the subscribers in the packets, in the order of the subscribers.
+     * @param backgroundInterval The time between two snapshots of all the players sent to all the subscribers, in
+     * milliseconds.
+     */
+    void setInterestManagement(const PotentiallyVisibleSet *pvs, const std::vector<int> &ids, int backgroundInterval);
+
+    /**
+     * @brief Receives the updates until the next tick, then sends the snapshot of the entities updated since the last
+     * tick, if any.
+     */
+    void update();
+
+    /**
+     * @brief Gets the port the relay receives the updates on.
+     *
+     * @return The port.
+     */
+    int getPort() const;
+
+    /**
+     * @brief Gets the counters of the relay.
+     *
+     * @return The counters since the creation of the relay.
+     */
+    RelayStats getStats() const;
+
+private:
+    UDPReceiver receiver;                    // The socket receiving the updates.
+    UDPFanoutSender sender;                  // The socket sending the snapshots to the subscribers.
+    PeerTable peers;                         // Drops the stale and malformed packets.
+    PositionPacket packet;                   // The packet decoded or encoded.
+    int id;                                  // The id of the relay.
+    int tick;                                // The time between two snapshots, in milliseconds.
+    std::vector<uint32_t> sequences;         // The sequence number of the next packet sent to every subscriber.
+    std::vector<int> everyone;               // The indexes of all the subscribers.
+    uint32_t nextTick;                       // The time of the next snapshot.
+    uint32_t start;                          // The time the relay started.
+    std::vector<EntityUpdate> latest;        // The last update of every entity, by id.
+    std::vector<bool> updated;               // Whether every entity was updated since the last tick, by id.
+    std::vector<int> updatedIds;             // The ids of the entities updated since the last tick.
+    std::vector<bool> known;                 // Whether every entity was updated at least once, by id.
+    std::vector<int> knownIds;               // The ids of the entities updated at least once.
+    const PotentiallyVisibleSet *pvs;        // The potentially visible set of the map (NULL to send all the updates).
+    std::vector<int> subscriberIds;          // The ids of the subscribers in the packets.
+    std::vector<int> subscriberCells;        // The cell every subscriber was in at the last tick (-1 if unknown).
+    int backgroundInterval;                  // The time between two snapshots of all the players, in milliseconds.
+    uint32_t nextBackground;                 // The time of the next snapshot of all the players.
+    std::vector<std::pair<int, int>> groups; // The cell of every subscriber and its index, sorted by cell.
+    std::vector<int> destinations;           // The indexes of the subscribers of a group.
+    RelayStats stats;                        // The counters of the relay.
+
+    /**
+     * @brief Sends the updates received since the last tick to the subscribers.
+     */
+    void sendSnapshot();
+
+    /**
+     * @brief Sends the last updates of some entities to some subscribers, in as few packets as possible.
+     *
+     * @param ids The ids of the entities.
+     * @param indexes The indexes of the subscribers (all of them if NULL).
+     * @param cell The cell the subscribers are in, only the entities possibly visible from it being sent (-1 for all).
+     */
+    void sendUpdates(const std::vector<int> &ids, const std::vector<int> *indexes, int cell);
+};
+
+#endif
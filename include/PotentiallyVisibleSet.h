@@ -0,0 +1,121 @@
+#ifndef POTENTIALLYVISIBLESET_H
+#define POTENTIALLYVISIBLESET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Map.h>
+
+/**
+ * @brief Which cells of a map can possibly be seen from which others, the cells being squares of tiles.
+ *
+ * The set is computed offline by casting rays in all directions from several points of every empty tile, through the
+ * tiles of the map until they hit a wall. A cell sees another if a ray from one of its tiles reaches a tile of the
+ * other. The result is made symmetric and grown by one cell in every direction, which covers the rays that slipped
+ * between two others and the players moving between two updates.
+ */
+class PotentiallyVisibleSet
+{
+public:
+    /**
+     * @brief Computes the potentially visible set of a map.
+     *
+     * @param map The map.
+     * @param cellSize The width and height of the cells, in tiles.
+     */
+    PotentiallyVisibleSet(const Map &map, int cellSize);
+
+    /**
+     * @brief Computes the potentially visible set of a grid of tiles.
+     *
+     * @param walls Whether every tile is a wall, row by row.
+     * @param width The width of the grid.
+     * @param height The height of the grid.
+     * @param cellSize The width and height of the cells, in tiles.
+     */
+    PotentiallyVisibleSet(const std::vector<bool> &walls, int width, int height, int cellSize);
+
+    /**
+     * @brief Loads a potentially visible set written by save.
+     *
+     * @param path The path to the file.
+     * @return The potentially visible set.
+     */
+    static PotentiallyVisibleSet load(const std::string &path);
+
+    /**
+     * @brief Writes the potentially visible set to a file.
+     *
+     * @param path The path to the file.
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Gets the cell holding a position.
+     *
+     * @param x The x-coordinate of the position.
+     * @param y The y-coordinate of the position.
+     * @return The index of the cell, or -1 if the position is outside of the map.
+     */
+    int getCell(double x, double y) const;
+
+    /**
+     * @brief Checks if a cell can possibly be seen from another.
+     *
+     * @param from The index of the cell seen from.
+     * @param to The index of the cell seen.
+     * @return true if the cell can possibly be seen, false if it cannot be seen from any point of the other.
+     */
+    bool isVisible(int from, int to) const;
+
+    /**
+     * @brief Gets the number of cells.
+     *
+     * @return The number of cells.
+     */
+    int getCellCount() const;
+
+    /**
+     * @brief Gets the fraction of the pairs of cells that can possibly see each other.
+     *
+     * @return The fraction, in [0, 1].
+     */
+    double getVisibleFraction() const;
+
+    static const int version = 1;         // The version of the file format.
+    static const int raysPerPoint = 1024; // The number of rays cast from every point of the empty tiles.
+
+private:
+    int width, height;          // The width and height of the map, in tiles.
+    int cellSize;               // The width and height of the cells, in tiles.
+    int columns, rows;          // The number of columns and rows of cells.
+    int words;                  // The number of 64-bit words of a row of the matrix.
+    std::vector<uint64_t> bits; // The visibility matrix, a row of bits per cell seen from.
+
+    /**
+     * @brief Constructs a PotentiallyVisibleSet object where no cell sees another.
+     *
+     * @param width The width of the map, in tiles.
+     * @param height The height of the map, in tiles.
+     * @param cellSize The width and height of the cells, in tiles.
+     */
+    PotentiallyVisibleSet(int width, int height, int cellSize);
+
+    /**
+     * @brief Marks a cell as possibly seen from another.
+     *
+     * @param from The index of the cell seen from.
+     * @param to The index of the cell seen.
+     */
+    void setVisible(int from, int to);
+
+    /**
+     * @brief Casts the rays from the empty tiles of the grid, then grows and symmetrizes the result.
+     *
+     * @param walls Whether every tile is a wall, row by row.
+     */
+    void compute(const std::vector<bool> &walls);
+};
+
+#endif
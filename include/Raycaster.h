@@ -2,10 +2,82 @@
 #define RAYCASTER_H
 
 #include <vector>
+#include <string>
+#include <ostream>
 
 #include <Player.h>
 #include <WindowManager.h>
 #include <Map.h>
+#include <WallSegments.h>
+#include <DepthPyramid.h>
+#include <SpriteSorter.h>
+
+/**
+ * @brief The engines available to cast the walls of the scene.
+ */
+enum class WallEngine
+{
+    DDA,      // One ray is traced through the map grid for every column of the screen.
+    SEGMENTS, // The wall faces of the map are projected once each and their columns are filled front to back.
+    ADAPTIVE, // One ray is traced every few columns, the columns in between are interpolated when they see the same face.
+};
+
+/**
+ * @brief The modes deciding which pixels are shaded in every frame.
+ */
+enum class RenderMode
+{
+    FULL,         // Every pixel is shaded in every frame.
+    CHECKERBOARD, // Half the pixels, in a checkerboard pattern alternating every frame, are shaded; the others are reconstructed.
+    INTERLACED,   // Every other column, alternating every frame, is shaded; the others are reconstructed.
+};
+
+/**
+ * @brief Represents the wall seen through a column of the screen.
+ */
+struct WallHit
+{
+    double perpWallDist; // The distance from the wall to the camera plane.
+    int mapX, mapY;      // The map cell of the wall.
+    int side;            // 0 if a NS wall was hit, 1 if an EW wall was hit.
+    int texX;            // The x-coordinate on the texture of the wall.
+};
+
+/**
+ * @brief The reprojection of a column of the screen into the previous frame (used to reconstruct missing pixels).
+ */
+struct ColumnReprojection
+{
+    double rayX, rayY;      // The direction of the ray of the column.
+    double prevX;           // The x-coordinate of the wall of the column in the previous frame.
+    double depthRatio;      // The ratio of the depths of the wall in the current and previous frames (negative if it was behind).
+    int drawStart, drawEnd; // The rows covered by the wall of the column.
+};
+
+/**
+ * @brief Counters accumulated by the raycaster over the frames, reporting how much work the render passes did.
+ */
+struct RenderStats
+{
+    long columns = 0;               // The number of wall columns cast.
+    long tracedColumns = 0;         // The number of wall columns for which a ray was traced through the map grid.
+    long reconstructedPixels = 0;   // The number of pixels reconstructed instead of shaded.
+    long reprojectedPixels = 0;     // The number of reconstructed pixels taken from the reprojected previous frame.
+    long sprites = 0;               // The number of sprites considered for drawing.
+    long spriteCandidates = 0;      // The number of sprites in the cells of the sprite grid inside the view cone.
+    long spritesOutsideFrustum = 0; // The number of sprites culled because they are behind the camera, off screen or hidden.
+    long spritesOccluded = 0;       // The number of sprites culled because they are behind the walls of all their columns.
+    long spriteSorts = 0;           // The number of times the drawn sprites were sorted.
+    long spriteSortRepairs = 0;     // The number of sprite sorts done by repairing the order of the previous frame.
+};
+
+/**
+ * @brief Writes a summary of the render statistics.
+ * @param os The stream to write to.
+ * @param stats The render statistics.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const RenderStats &stats);
 
 /**
  * @brief The Raycaster class is responsible for casting rays and rendering the scene in a 3D environment.
@@ -27,15 +99,79 @@ public:
     void castFloorCeiling();
 
     /**
-     * @brief Casts rays to render the walls of the scene.
+     * @brief Casts rays to render the walls of the scene, using the selected wall engine.
      */
     void castWalls();
 
+    /**
+     * @brief Selects the engine used to cast the walls.
+     * @param engine The wall engine to use.
+     */
+    void setWallEngine(WallEngine engine);
+
+    /**
+     * @brief Sets the distance between the columns traced first by the adaptive wall engine.
+     * @param step The number of columns between two traced columns (at least 1).
+     */
+    void setAdaptiveStep(int step);
+
+    /**
+     * @brief Sets the distance of the light falloff: the brightness of the walls, floor, ceiling and sprites halves
+     * every time their distance grows by this amount.
+     * @param distance The distance halving the brightness (0 to disable the falloff).
+     */
+    void setFogDistance(double distance);
+
+    /**
+     * @brief Parses the name of a wall engine ("dda", "segments" or "adaptive").
+     * @param name The name of the wall engine.
+     * @return The corresponding wall engine.
+     */
+    static WallEngine parseWallEngine(const std::string &name);
+
+    /**
+     * @brief Gets the distance of the walls for every column of the last frame.
+     * @return The buffer of the wall distances.
+     */
+    const std::vector<double> &getZBuffer() const;
+
+    /**
+     * @brief Gets the walls seen through every column of the last frame.
+     * @return The list of the wall hits, one per column.
+     */
+    const std::vector<WallHit> &getWallHits() const;
+
+    /**
+     * @brief Gets the statistics accumulated since the creation of the raycaster.
+     * @return The render statistics.
+     */
+    const RenderStats &getStats() const;
+
     /**
      * @brief Casts rays to render the sprites in the scene.
      */
     void castSprites();
 
+    /**
+     * @brief Completes the frame once all the passes are cast. In the checkerboard and interlaced modes, the pixels
+     * not shaded in this frame are reconstructed from the previous frame, reprojected with the motion of the player,
+     * or from their shaded neighbors when the motion is too large.
+     */
+    void finishFrame();
+
+    /**
+     * @brief Selects which pixels are shaded in every frame.
+     * @param mode The render mode to use.
+     */
+    void setRenderMode(RenderMode mode);
+
+    /**
+     * @brief Parses the name of a render mode ("full", "checkerboard" or "interlaced").
+     * @param name The name of the render mode.
+     * @return The corresponding render mode.
+     */
+    static RenderMode parseRenderMode(const std::string &name);
+
 private:
     Player &player;               // The reference to the Player object.
     WindowManager &windowManager; // The reference to the WindowManager object.
@@ -44,15 +180,227 @@ private:
     int screenWidth, screenHeight;        // The screen width and height.
     Texture floorTexture, ceilingTexture; // The textures for the floor and ceiling.
 
-    std::vector<double> zBuffer;        // The buffer for storing the distance of the walls from the player (used for rendering sprites).
-    std::vector<int> spriteOrder;       // The order of the sprites for rendering.
-    std::vector<double> spriteDistance; // The distances of the sprites from the player.
-    int numSprites;                     // The number of sprites in the map.
+    WallEngine wallEngine;                               // The engine used to cast the walls.
+    int adaptiveStep;                                    // The distance between the columns traced first by the adaptive engine.
+    WallSegments wallSegments;                           // The wall faces of the map (used by the segment engine).
+    std::vector<WallHit> wallHits;                       // The wall seen through every column of the screen.
+    std::vector<WallSegment> visibleSegments;            // The segments facing the player in the current frame.
+    std::vector<double> segmentDepths;                   // The nearest depth of every visible segment.
+    std::vector<std::pair<int, int>> segmentColumns;     // The range of columns covered by every visible segment.
+    std::vector<int> segmentOrder;                       // The order of the visible segments, from nearest to farthest.
+    std::vector<int> nextOpenColumn;                     // The span buffer of the segment engine: the next column that may still change.
+    std::vector<double> cornerDistances;                 // The distance at which every column passes nearest to a tile corner on a face (segment engine).
+    std::vector<ColumnReprojection> columnReprojections; // The reprojection of every column into the previous frame.
+
+    std::vector<double> zBuffer;         // The buffer for storing the distance of the walls from the player (used for rendering sprites).
+    std::vector<int> spriteCandidates;   // The slots of the sprites in the cells of the sprite grid inside the view cone.
+    SpriteProjections spriteProjections; // The projection of the candidate sprites, by slot.
+    DepthPyramid depthPyramid;           // The min/max pyramid of the zBuffer, used to cull the sprites hidden by walls.
+    std::vector<int> spriteUnoccluded;   // 1 if no wall is in front of the sprite in any of its columns, by slot.
+    std::vector<int> spriteOrder;        // The order of the sprites for rendering (slots of the sprites).
+    std::vector<double> spriteDistance;  // The distances of the sprites from the player.
+    SpriteSorter spriteSorter;           // The sorter of the sprites, keeping their order from one frame to the next.
+    int numSprites;                      // The number of sprites drawn in the current frame.
+
+    RenderMode renderMode;                                             // The mode deciding which pixels are shaded.
+    int frameParity;                                                   // The parity of the pixels shaded in the current frame (alternates every frame).
+    bool hasPreviousFrame;                                             // Whether a previous frame can be reprojected.
+    double prevPosX, prevPosY, prevDirX, prevDirY, prevCamX, prevCamY; // The camera of the previous frame.
+
+    double fogDistance; // The distance halving the brightness (0 if there is no light falloff).
+
+    RenderStats stats; // The statistics of the render passes.
+
+    /**
+     * @brief Gets the shade level of a texture seen at a distance.
+     * @param distance The distance along the direction of the camera.
+     * @param offset The shade levels added to the ones of the distance (e.g. the side darkening of the walls).
+     * @return The shade level, clamped to the levels of the textures.
+     */
+    int shadeAt(double distance, int offset) const;
 
     /**
-     * @brief Sorts the sprites based on their distance from the player.
+     * @brief Sorts the sprites based on their distance from the player, from the farthest to the nearest.
      */
     void sortSprites();
+
+    /**
+     * @brief Selects the sprites to draw: the sprites outside the view frustum or hidden by the walls of all their
+     * columns are culled, the others are stored in spriteOrder with their distance.
+     */
+    void cullSprites();
+
+    /**
+     * @brief Casts the walls by tracing one DDA ray per column.
+     */
+    void castWallsDDA();
+
+    /**
+     * @brief Casts the walls by projecting the wall segments of the map front to back.
+     */
+    void castWallsSegments();
+
+    /**
+     * @brief Casts the walls by tracing a ray every few columns and interpolating the columns in between.
+     */
+    void castWallsAdaptive();
+
+    /**
+     * @brief Fills the columns strictly between two traced columns, interpolating them if both see the same face of
+     * the same cell, or tracing the middle column and refining both halves otherwise.
+     * @param x0 The traced column on the left.
+     * @param x1 The traced column on the right.
+     * @return The number of columns traced to fill the gap.
+     */
+    int fillColumns(int x0, int x1);
+
+    /**
+     * @brief Traces the ray of a column through the map grid until it hits a wall.
+     * @param x The column of the screen.
+     * @param hit The wall hit by the ray.
+     */
+    void traceColumn(int x, WallHit &hit) const;
+
+    /**
+     * @brief Computes the x-coordinate on the wall texture where the ray of a column hits a wall.
+     * @param hit The wall hit, whose texX is set.
+     * @param ray The direction of the ray.
+     */
+    void computeTexX(WallHit &hit, const Vector<double> &ray) const;
+
+    /**
+     * @brief Finds the first column from the given one that may still be changed by the segment engine.
+     * @param x The column to start from.
+     * @return The first open column, or screenWidth if there is none.
+     */
+    int findOpenColumn(int x);
+
+    /**
+     * @brief Draws the wall of a column and stores its distance in the zBuffer.
+     * @param x The column of the screen.
+     */
+    void drawWallColumn(int x);
+
+    /**
+     * @brief Draws the shaded pixels of a floor row and of the symmetrical ceiling row, the column x showing the floor
+     * point basis + x * step. The samplers of the textures are chosen once for the rows.
+     * @param y The floor row of the screen.
+     * @param basisX The x-coordinate of the floor point of the leftmost column.
+     * @param basisY The y-coordinate of the floor point of the leftmost column.
+     * @param stepX The x distance between the floor points of two columns.
+     * @param stepY The y distance between the floor points of two columns.
+     * @param shade The shade level of the rows.
+     */
+    void drawFloorRow(int y, double basisX, double basisY, double stepX, double stepY, int shade);
+
+    /**
+     * @brief Draws a floor row and the symmetrical ceiling row in a format of the frame (see drawFloorRow).
+     * @tparam Color The type of the texels in the format of the frame.
+     * @param y The floor row of the screen.
+     * @param basisX The x-coordinate of the floor point of the leftmost column.
+     * @param basisY The y-coordinate of the floor point of the leftmost column.
+     * @param stepX The x distance between the floor points of two columns.
+     * @param stepY The y distance between the floor points of two columns.
+     * @param shade The shade level of the rows.
+     */
+    template <typename Color>
+    void drawFloorRowAs(int y, double basisX, double basisY, double stepX, double stepY, int shade);
+
+    /**
+     * @brief Draws a floor row and the symmetrical ceiling row with the samplers of their textures (see drawFloorRow).
+     * @param y The floor row of the screen.
+     * @param basisX The x-coordinate of the floor point of the leftmost column.
+     * @param basisY The y-coordinate of the floor point of the leftmost column.
+     * @param stepX The x distance between the floor points of two columns.
+     * @param stepY The y distance between the floor points of two columns.
+     * @param floor The sampler of the floor texture, in the format of the frame.
+     * @param ceiling The sampler of the ceiling texture, in the format of the frame.
+     */
+    template <typename FloorSampler, typename CeilingSampler>
+    void drawFloorTexels(int y, double basisX, double basisY, double stepX, double stepY, FloorSampler floor,
+                         CeilingSampler ceiling);
+
+    /**
+     * @brief Draws the shaded pixels of the opaque runs of a column of a sprite. The sampler of the texture is chosen
+     * once for the column.
+     * @param stripe The column of the screen.
+     * @param texX The column of the texture.
+     * @param spans The opaque runs of the columns of the texture.
+     * @param drawStartY The first row of the screen covered by the sprite.
+     * @param drawEndY The last row of the screen covered by the sprite.
+     * @param spriteHeight The height of the sprite on the screen.
+     * @param texture The texture of the sprite.
+     * @param shade The shade level of the sprite.
+     */
+    void drawSpriteColumn(int stripe, int texX, const OpaqueSpans &spans, int drawStartY, int drawEndY, int spriteHeight,
+                          const Texture &texture, int shade);
+
+    /**
+     * @brief Draws the shaded pixels of the opaque runs of a column of a sprite with the sampler of its texture (see
+     * drawSpriteColumn).
+     * @param stripe The column of the screen.
+     * @param texX The column of the texture.
+     * @param spans The opaque runs of the columns of the texture.
+     * @param drawStartY The first row of the screen covered by the sprite.
+     * @param drawEndY The last row of the screen covered by the sprite.
+     * @param spriteHeight The height of the sprite on the screen.
+     * @param textureHeight The height of the texture of the sprite.
+     * @param sampler The sampler of the texture, in the format of the frame.
+     */
+    template <typename Sampler>
+    void drawSpriteTexels(int stripe, int texX, const OpaqueSpans &spans, int drawStartY, int drawEndY, int spriteHeight,
+                          int textureHeight, Sampler sampler);
+
+    /**
+     * @brief Checks whether the pixels of a column are shaded in the current frame (only false in the interlaced mode).
+     * @param x The column of the screen.
+     * @return True if the column is shaded.
+     */
+    bool isShadedColumn(int x) const;
+
+    /**
+     * @brief Gets the first column from the left whose pixel is shaded in a row of the current frame.
+     * @param y The row of the screen.
+     * @return The first shaded column (0 or 1).
+     */
+    int firstShadedColumn(int y) const;
+
+    /**
+     * @brief Gets the first row from the given one whose pixel is shaded in a column of the current frame.
+     * @param x The column of the screen.
+     * @param y The row to start from.
+     * @return The first shaded row (y or y + 1).
+     */
+    int firstShadedRow(int x, int y) const;
+
+    /**
+     * @brief Gets the distance between two shaded pixels of a row.
+     * @return 1 in the full mode, 2 otherwise.
+     */
+    int shadedColumnStep() const;
+
+    /**
+     * @brief Gets the distance between two shaded pixels of a column.
+     * @return 2 in the checkerboard mode, 1 otherwise.
+     */
+    int shadedRowStep() const;
+
+    /**
+     * @brief Reconstructs a pixel not shaded in the current frame from the previous frame.
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param prevX The x-coordinate of the same point in the previous frame.
+     * @param prevY The y-coordinate of the same point in the previous frame.
+     * @return True if the point was on the screen in the previous frame, false if the pixel was spatially filled.
+     */
+    bool reprojectPixel(int x, int y, double prevX, double prevY);
+
+    /**
+     * @brief Reconstructs a pixel not shaded in the current frame from its shaded neighbors.
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     */
+    void spatialFillPixel(int x, int y);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef SENDSCHEDULER_H
+#define SENDSCHEDULER_H
+
+#include <cstdint>
+#include <ostream>
+
+#include <PositionPacket.h>
+
+/**
+ * @brief Counters of the states offered to and sent by a SendScheduler.
+ */
+struct SendSchedulerStats
+{
+    long changes = 0;   // The number of states offered, i.e. of packets sent if every change was sent.
+    long sent = 0;      // The number of states sent.
+    long keyframes = 0; // The number of states sent because no state was sent for a keyframe interval.
+    double seconds = 0; // The time since the first state offered.
+};
+
+/**
+ * @brief Writes a summary of the counters of a send scheduler.
+ * @param os The stream to write to.
+ * @param stats The counters of the scheduler.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const SendSchedulerStats &stats);
+
+/**
+ * @brief Decides when the state of the local player is sent, so that the packet rate does not follow the frame rate.
+ *
+ * The states offered between two sends collapse into the newest one. It is sent once it moved or turned enough from
+ * the last state sent, and no sooner than the interval of the maximum rate after it. The state the player stopped in
+ * is sent once it was still for an interval, and a keyframe repeats the last state when nothing was sent for a while,
+ * so that the players who lost a packet catch up.
+ */
+class SendScheduler
+{
+public:
+    /**
+     * @brief Constructs a SendScheduler object, with no state to send.
+     *
+     * @param maxRate The most states sent per second (0 for no limit).
+     * @param minMove The smallest distance from the last state sent worth sending.
+     * @param minTurn The smallest rotation from the last state sent worth sending, in radians.
+     * @param keyframeInterval The longest time without sending, in milliseconds (0 for no keyframes).
+     */
+    SendScheduler(double maxRate, double minMove, double minTurn, int keyframeInterval);
+
+    /**
+     * @brief Offers the new state of the player, replacing the one not sent yet.
+     *
+     * @param state The state of the player.
+     * @param now The current time, in milliseconds (see PositionPacket::now).
+     */
+    void update(const EntityUpdate &state, uint32_t now);
+
+    /**
+     * @brief Takes the state to send now, if any.
+     *
+     * @param now The current time, in milliseconds.
+     * @param state The state to send.
+     * @return true if the state must be sent, false if nothing is to be sent now (the state is not set).
+     */
+    bool poll(uint32_t now, EntityUpdate &state);
+
+    /**
+     * @brief Gets the time until poll has a state to send, if no new state is offered meanwhile.
+     *
+     * @param now The current time, in milliseconds.
+     * @return The time in milliseconds, or -1 if there is nothing to send.
+     */
+    int getWait(uint32_t now) const;
+
+    /**
+     * @brief Gets the counters of the scheduler.
+     *
+     * @param now The current time, in milliseconds.
+     * @return The counters since the first state offered.
+     */
+    SendSchedulerStats getStats(uint32_t now) const;
+
+private:
+    int interval;             // The shortest time between two sends, in milliseconds.
+    double minMove;           // The smallest distance worth sending.
+    double minTurn;           // The smallest rotation worth sending, in radians.
+    int keyframeInterval;     // The longest time without sending, in milliseconds (0 for no keyframes).
+    bool hasState, hasSent;   // Whether a state was offered, and sent.
+    EntityUpdate newest;      // The newest state offered.
+    EntityUpdate last;        // The last state sent.
+    uint32_t updated;         // The time the newest state was offered.
+    uint32_t sentAt;          // The time the last state was sent.
+    uint32_t start;           // The time the first state was offered.
+    SendSchedulerStats stats; // The counters of the scheduler.
+
+    /**
+     * @brief Gets the time from which the newest state is to be sent.
+     *
+     * @param time Set to the time in milliseconds.
+     * @param keyframe Set to whether sending the state then is a keyframe.
+     * @return false if there is nothing to send (time and keyframe are not set), true otherwise.
+     */
+    bool getSendTime(uint32_t &time, bool &keyframe) const;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SHAREDMEMORYRECEIVER_H
+#define SHAREDMEMORYRECEIVER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <SharedMemoryRing.h>
+#include <UDPReceiver.h>
+
+/**
+ * @brief Counters of a SharedMemoryReceiver: those of a UDPReceiver, and the packets lost in the rings.
+ */
+struct SharedMemoryReceiveStats : ReceiveStats
+{
+    long dropped = 0; // The number of packets overwritten in a shared memory ring before they were read.
+};
+
+/**
+ * @brief Receives the packets of the players of the host from their shared memory rings.
+ *
+ * The receiver drains the rings of the players, then sleeps on the doorbell of the player until one of them writes a
+ * packet: no system call while packets keep arriving, and a single futex wait when none does. The segments of the
+ * players are opened when they start, the players that do not run yet being checked again every second, or when an
+ * unknown player rings the doorbell.
+ */
+class SharedMemoryReceiver
+{
+public:
+    /**
+     * @brief Constructs a SharedMemoryReceiver object with the specified players and a ring of 256 packets.
+     *
+     * @param ring The segment of the player, holding the doorbell (shared with its SharedMemorySender).
+     * @param ports The ports of the players of the host to receive the packets of.
+     */
+    SharedMemoryReceiver(std::shared_ptr<SharedMemoryRing> ring, const std::vector<int> &ports);
+
+    /**
+     * @brief Constructs a SharedMemoryReceiver object with the specified players and number of packets received at once.
+     *
+     * @param ring The segment of the player, holding the doorbell (shared with its SharedMemorySender).
+     * @param ports The ports of the players of the host to receive the packets of.
+     * @param capacity The number of packets of the ring of the receiver, i.e. the most packets returned by a call to receive.
+     */
+    SharedMemoryReceiver(std::shared_ptr<SharedMemoryRing> ring, const std::vector<int> &ports, int capacity);
+
+    /**
+     * @brief Waits until data arrives or the timeout expires, then receives all the pending packets (up to the capacity).
+     * @param timeoutMs The longest wait in milliseconds (-1 to wait forever, 0 to only drain the pending packets).
+     * @return The number of packets received, available through getPacket until the next call.
+     */
+    int receive(int timeoutMs);
+
+    /**
+     * @brief Gets a packet received by the last call to receive.
+     * @param i The index of the packet, in [0, the number of packets received).
+     * @return The packet, from the loopback address and the port of its player.
+     */
+    const ReceivedPacket &getPacket(int i) const;
+
+    /**
+     * @brief Gets the counters of the receiver.
+     * @return The counters since the creation of the receiver.
+     */
+    const SharedMemoryReceiveStats &getStats() const;
+
+private:
+    std::shared_ptr<SharedMemoryRing> ring;               // The segment of the player, holding the doorbell.
+    std::vector<int> ports;                               // The ports of the players.
+    std::vector<std::shared_ptr<SharedMemoryRing>> peers; // The segments of the players (NULL until they run).
+    std::vector<uint64_t> cursors;                        // The sequence number of the next packet of every player.
+    size_t firstPeer;                                     // The player drained first by the next call to drain.
+    uint32_t nextConnect;                                 // The time of the next check of the players (ms).
+    std::vector<ReceivedPacket> packets;                  // The ring of packets, filled from the start by every call to receive.
+    SharedMemoryReceiveStats stats;                       // The counters of the receiver.
+
+    /**
+     * @brief Opens the segments of the players that started, and closes those of the players that stopped.
+     *
+     * @param force Whether to check now rather than once a second.
+     */
+    void connect(bool force);
+
+    /**
+     * @brief Reads the pending packets of all the players into the ring of packets, up to its capacity.
+     * The player read first changes on every call so that none of them is always read last.
+     *
+     * @return The number of packets read.
+     */
+    int drain();
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef SHAREDMEMORYRING_H
+#define SHAREDMEMORYRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief The shared memory segment of a player, named after its port: a ring of the packets the player sends, read by
+ * all the players of the host, and the doorbell its receiver sleeps on.
+ *
+ * The ring has a single writer and any number of readers, each with its own cursor: a packet is written once for all
+ * of them, and the writer never waits for a reader. A reader that falls more than the capacity of the ring behind
+ * loses the oldest packets, like a full socket buffer. Every slot carries the sequence number of its packet (odd while
+ * it is written), so that a reader detects a slot overwritten while it was read. The doorbell is a futex: the writers
+ * increment it after every packet and only wake the reader with a system call if it sleeps.
+ */
+class SharedMemoryRing
+{
+public:
+    /**
+     * @brief Creates the segment of a player, replacing the segment left by a previous run.
+     *
+     * @param port The port of the player, which names the segment.
+     * @param capacity The number of packets of the ring.
+     * @return The segment.
+     * @throws std::runtime_error If the segment cannot be created.
+     */
+    static std::shared_ptr<SharedMemoryRing> create(int port, int capacity);
+
+    /**
+     * @brief Opens the segment of another player of the host.
+     *
+     * @param port The port of the player.
+     * @return The segment, or NULL if the player does not run or is not ready.
+     */
+    static std::shared_ptr<SharedMemoryRing> open(int port);
+
+    /**
+     * @brief Unmaps the segment. The creator marks it closed and removes its name first.
+     */
+    ~SharedMemoryRing();
+
+    /**
+     * @brief Starts writing the next packet of the ring (writer only).
+     *
+     * @return The buffer of the packet, of maxPayload bytes.
+     */
+    unsigned char *beginWrite();
+
+    /**
+     * @brief Publishes the packet started by beginWrite to the readers.
+     *
+     * @param length The size of the packet in bytes (at most maxPayload).
+     */
+    void endWrite(int length);
+
+    /**
+     * @brief Gets the sequence number of the next packet written.
+     *
+     * @return The sequence number, the cursor of a reader that only wants the packets written from now on.
+     */
+    uint64_t getHead() const;
+
+    /**
+     * @brief Reads the packet at the cursor of a reader and moves the cursor past it.
+     *
+     * @param cursor The sequence number of the next packet of the reader.
+     * @param data The buffer the packet is copied to, of maxPayload bytes.
+     * @param dropped Incremented by the number of packets overwritten before they were read.
+     * @return The size of the packet in bytes, or -1 if no packet is pending.
+     */
+    int read(uint64_t &cursor, unsigned char *data, long &dropped) const;
+
+    /**
+     * @brief Rings the doorbell of the player, waking its receiver if it sleeps.
+     *
+     * @return true if the receiver was woken up with a system call.
+     */
+    bool ring();
+
+    /**
+     * @brief Tells the writers whether the receiver of the player is about to sleep, so that they wake it up.
+     *
+     * @param sleeping true before checking the rings a last time and waiting, false after waiting.
+     */
+    void setSleeping(bool sleeping);
+
+    /**
+     * @brief Gets the number of times the doorbell rang, to wait for it to ring again.
+     *
+     * @return The value of the doorbell.
+     */
+    uint32_t getDoorbell() const;
+
+    /**
+     * @brief Sleeps until the doorbell rings or the timeout expires (call setSleeping first).
+     *
+     * @param doorbell The value of the doorbell read before checking the rings a last time.
+     * @param timeoutMs The longest wait in milliseconds (-1 to wait forever).
+     * @return true if the doorbell rang since it was read.
+     */
+    bool wait(uint32_t doorbell, int timeoutMs);
+
+    /**
+     * @brief Checks if the creator of the segment still runs.
+     *
+     * @return false if the creator closed the segment or died.
+     */
+    bool isAlive() const;
+
+    static const int maxPayload = 1472; // The largest packet (the largest UDP payload in an Ethernet frame).
+    static const uint32_t version = 1;  // The version of the layout of the segment.
+
+private:
+    /**
+     * @brief The header of the segment, followed by the slots of the ring.
+     */
+    struct Header
+    {
+        std::atomic<uint32_t> magic;                // "RSHM" once the segment is initialized.
+        uint32_t version;                           // The version of the layout.
+        int32_t pid;                                // The process of the creator.
+        uint32_t capacity;                          // The number of slots.
+        std::atomic<uint32_t> closed;               // 1 once the creator closed the segment.
+        alignas(64) std::atomic<uint64_t> head;     // The sequence number of the next packet written.
+        alignas(64) std::atomic<uint32_t> doorbell; // The futex incremented by the writers after every packet.
+        std::atomic<uint32_t> sleeping;             // 1 while the receiver of the player may sleep on the doorbell.
+    };
+
+    /**
+     * @brief A slot of the ring, holding a packet.
+     */
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> sequence; // 2s + 1 while the packet s is written, 2s + 2 once written, 0 if never.
+        int32_t length;                 // The size of the packet in bytes.
+        unsigned char data[maxPayload]; // The packet.
+    };
+
+    std::string name; // The name of the segment.
+    bool owner;       // Whether the segment was created by this object.
+    size_t size;      // The size of the mapping.
+    Header *header;   // The header, at the start of the mapping.
+    Slot *slots;      // The slots, after the header.
+
+    /**
+     * @brief Constructs a SharedMemoryRing object from a mapped segment.
+     *
+     * @param name The name of the segment.
+     * @param owner Whether the segment was created by this object.
+     * @param mapping The mapping of the segment.
+     * @param size The size of the mapping.
+     */
+    SharedMemoryRing(const std::string &name, bool owner, void *mapping, size_t size);
+
+    /**
+     * @brief Gets the name of the segment of a player.
+     *
+     * @param port The port of the player.
+     * @return The name.
+     */
+    static std::string getName(int port);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef SHAREDMEMORYSENDER_H
+#define SHAREDMEMORYSENDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <PositionPacket.h>
+#include <SharedMemoryRing.h>
+#include <UDPFanoutSender.h>
+
+/**
+ * @brief Sends the same payload to the players of the host through the shared memory ring of the player.
+ *
+ * The payload is written once in the ring, where every player of the host reads it, then the doorbells of the
+ * players are rung: a fan-out takes no system call, unless a player sleeps. The segments of the players are opened
+ * when they start, the players that do not run yet being checked again every second.
+ */
+class SharedMemorySender
+{
+public:
+    /**
+     * @brief Constructs a SharedMemorySender object writing to the ring of the player.
+     *
+     * @param ring The segment of the player, shared with its SharedMemoryReceiver.
+     * @param ports The ports of the players of the host to send the packets to.
+     */
+    SharedMemorySender(std::shared_ptr<SharedMemoryRing> ring, const std::vector<int> &ports);
+
+    /**
+     * @brief Sends a payload to all the destinations.
+     *
+     * @param data The payload.
+     * @param length The size of the payload in bytes (at most maxPayload).
+     */
+    void send(const void *data, int length);
+
+    /**
+     * @brief Sends a position packet to all the destinations, encoding it straight into the ring.
+     *
+     * @param packet The packet to send.
+     */
+    void send(const PositionPacket &packet);
+
+    /**
+     * @brief Gets the number of destinations.
+     *
+     * @return The number of destinations.
+     */
+    int getDestinationCount() const;
+
+    /**
+     * @brief Checks if a destination reads the ring, i.e. if its segment was opened by the last checks.
+     *
+     * @param i The index of the destination, in the order of the ports given to the constructor.
+     * @return true if the segment of the destination is open and its player was alive when checked.
+     */
+    bool isConnected(int i) const;
+
+    /**
+     * @brief Gets the counters of the sender.
+     *
+     * @return The counters since the creation of the sender, the system calls being the wake-ups of the players.
+     */
+    const SendStats &getStats() const;
+
+    static const int maxPayload = SharedMemoryRing::maxPayload; // The largest payload sent.
+
+private:
+    std::shared_ptr<SharedMemoryRing> ring;               // The segment of the player, holding the ring written.
+    std::vector<int> ports;                               // The ports of the destinations.
+    std::vector<std::shared_ptr<SharedMemoryRing>> peers; // The segments of the destinations (NULL until they run).
+    uint32_t nextConnect;                                 // The time of the next check of the destinations (ms).
+    SendStats stats;                                      // The counters of the sender.
+
+    /**
+     * @brief Publishes the packet written in the ring and rings the doorbells of the destinations.
+     *
+     * @param length The size of the packet in bytes.
+     * @param start The time the fan-out started.
+     */
+    void publish(int length, std::chrono::steady_clock::time_point start);
+};
+
+#endif
@@ -2,10 +2,9 @@
 #define SPRITE_H
 
 #include <Vector.h>
-#include <Texture.h>
 
 /**
- * @brief Represents a sprite in the game.
+ * @brief Describes a sprite placed in the game: its position and the index of its texture in the map.
  */
 class Sprite
 {
@@ -14,32 +13,16 @@ public:
      * @brief Constructs a Sprite object with the given position and texture.
      *
      * @param position The position of the sprite.
-     * @param texture The texture of the sprite.
+     * @param textureId The index of the texture of the sprite in the sprite textures of the map.
      */
-    Sprite(Vector<double> position, const Texture &texture);
+    Sprite(Vector<double> position, int textureId);
 
     /**
-     * @brief Gets the pixel value at the specified coordinates from the texture of the sprite.
+     * @brief Gets the index of the texture of the sprite.
      *
-     * @param x The x-coordinate.
-     * @param y The y-coordinate.
-     * @return The pixel value at the specified coordinates.
+     * @return The index of the texture of the sprite.
      */
-    unsigned int get(int x, int y) const;
-
-    /**
-     * @brief Gets the width of the sprite.
-     *
-     * @return The width of the sprite.
-     */
-    int getWidth() const;
-
-    /**
-     * @brief Gets the height of the sprite.
-     *
-     * @return The height of the sprite.
-     */
-    int getHeight() const;
+    int getTextureId() const;
 
     /**
      * @brief Gets the x-coordinate of the sprite's position.
@@ -55,17 +38,9 @@ public:
      */
     double posY() const;
 
-    /**
-     * @brief Moves the sprite to the specified position.
-     *
-     * @param x The x-coordinate of the new position.
-     * @param y The y-coordinate of the new position.
-     */
-    void move(double x, double y);
-
 private:
     Vector<double> position; // The position of the sprite.
-    Texture texture;         // The texture of the sprite.
+    int textureId;           // The index of the texture of the sprite.
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,143 @@
+#ifndef SPRITEGRID_H
+#define SPRITEGRID_H
+
+#include <vector>
+
+/**
+ * @brief A uniform grid indexing the sprites by position, so that the queries only visit the sprites around them.
+ *
+ * Every cell holds an intrusive list of the ids of the sprites inside it: inserting, removing and moving a sprite are
+ * constant time, and allocate nothing. The positions outside of the grid are clamped into its border cells.
+ */
+class SpriteGrid
+{
+public:
+    /**
+     * @brief Constructs an empty SpriteGrid object covering the area [0, width) x [0, height).
+     *
+     * @param width The width of the area covered by the grid.
+     * @param height The height of the area covered by the grid.
+     * @param cellSize The size of the cells of the grid.
+     * @param capacity The maximum number of sprites, and the bound of their ids.
+     */
+    SpriteGrid(int width, int height, double cellSize, int capacity);
+
+    /**
+     * @brief Inserts a sprite in the grid.
+     *
+     * @param id The id of the sprite.
+     * @param x The x-coordinate of the sprite.
+     * @param y The y-coordinate of the sprite.
+     */
+    void insert(int id, double x, double y);
+
+    /**
+     * @brief Removes a sprite from the grid.
+     *
+     * @param id The id of the sprite.
+     */
+    void remove(int id);
+
+    /**
+     * @brief Moves a sprite of the grid. The lists are only updated when the sprite changes cell.
+     *
+     * @param id The id of the sprite.
+     * @param x The x-coordinate of the new position.
+     * @param y The y-coordinate of the new position.
+     */
+    void move(int id, double x, double y);
+
+    /**
+     * @brief Gets the sprites of a cell.
+     *
+     * @param cellX The column of the cell.
+     * @param cellY The row of the cell.
+     * @param ids The ids of the sprites of the cell (cleared first).
+     */
+    void queryCell(int cellX, int cellY, std::vector<int> &ids) const;
+
+    /**
+     * @brief Gets the sprites within a distance of a point.
+     *
+     * @param x The x-coordinate of the point.
+     * @param y The y-coordinate of the point.
+     * @param radius The maximum distance from the point.
+     * @param ids The ids of the sprites within the distance (cleared first).
+     */
+    void queryRadius(double x, double y, double radius, std::vector<int> &ids) const;
+
+    /**
+     * @brief Gets the sprites of the cells that intersect the view cone of a camera, widened by a margin for the size of
+     * the sprites. The result is conservative: the sprites are not tested individually, and the cone is not bounded in
+     * depth.
+     *
+     * @param posX The x-coordinate of the camera.
+     * @param posY The y-coordinate of the camera.
+     * @param dirX The x-component of the direction of the camera.
+     * @param dirY The y-component of the direction of the camera.
+     * @param camX The x-component of the camera plane.
+     * @param camY The y-component of the camera plane.
+     * @param margin The distance by which the cone is widened (the half-width of the sprites).
+     * @param ids The ids of the sprites of the cells in the cone (cleared first).
+     */
+    void queryCone(double posX, double posY, double dirX, double dirY, double camX, double camY, double margin,
+                   std::vector<int> &ids) const;
+
+    /**
+     * @brief Gets the number of columns of cells.
+     *
+     * @return The number of columns.
+     */
+    int getCellsX() const;
+
+    /**
+     * @brief Gets the number of rows of cells.
+     *
+     * @return The number of rows.
+     */
+    int getCellsY() const;
+
+private:
+    int cellsX, cellsY;          // The number of columns and rows of cells.
+    double cellSize;             // The size of the cells.
+    std::vector<int> heads;      // The first sprite of every cell (-1 for an empty cell).
+    std::vector<int> next, prev; // The next and previous sprites in the cell of every sprite (-1 at the ends).
+    std::vector<int> cells;      // The cell of every sprite (-1 if the sprite is not in the grid).
+    std::vector<double> xs, ys;  // The position of every sprite.
+
+    /**
+     * @brief Gets the cell containing a position, clamped to the grid.
+     *
+     * @param x The x-coordinate of the position.
+     * @param y The y-coordinate of the position.
+     * @return The index of the cell.
+     */
+    int cellAt(double x, double y) const;
+
+    /**
+     * @brief Links a sprite at the head of the list of a cell.
+     *
+     * @param id The id of the sprite.
+     * @param cell The index of the cell.
+     */
+    void link(int id, int cell);
+
+    /**
+     * @brief Unlinks a sprite from the list of its cell.
+     *
+     * @param id The id of the sprite.
+     */
+    void unlink(int id);
+
+    /**
+     * @brief Appends the sprites of a range of cells of a row.
+     *
+     * @param cellY The row of the cells.
+     * @param cellX0 The first column of the range.
+     * @param cellX1 The last column of the range (included).
+     * @param ids The list to append the ids to.
+     */
+    void appendRow(int cellY, int cellX0, int cellX1, std::vector<int> &ids) const;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef SPRITEPOOL_H
+#define SPRITEPOOL_H
+
+#include <vector>
+
+/**
+ * @brief The projection of the sprites of a pool on the screen, one entry per slot of the pool.
+ */
+struct SpriteProjections
+{
+    std::vector<double> distance;   // The squared distance from the camera to the sprite.
+    std::vector<double> transformY; // The depth of the sprite in camera space (negative if it is behind the camera).
+    std::vector<int> screenX;       // The column of the center of the sprite.
+    std::vector<int> size;          // The width and height of the sprite on the screen.
+    std::vector<int> drawStartX;    // The first column covered by the sprite, clamped to the screen.
+    std::vector<int> drawEndX;      // The column after the last one covered by the sprite, clamped to the screen.
+    std::vector<int> visible;       // 1 if the sprite is in front of the camera and covers at least one column, 0 otherwise.
+
+    /**
+     * @brief Resizes all the arrays of the projections.
+     *
+     * @param n The number of entries.
+     */
+    void resize(int n);
+};
+
+/**
+ * @brief Stores sprites as a structure of arrays, so that the per-frame kernels stream through contiguous arrays.
+ *
+ * The sprites are kept packed in the slots [0, size()), in no particular order. Every sprite is also identified by a
+ * stable id, which stays valid until the sprite is removed. All the arrays are allocated once with the capacity of
+ * the pool: adding and removing sprites never reallocates.
+ */
+class SpritePool
+{
+public:
+    /**
+     * @brief Flag of a sprite that is not drawn (e.g. a player whose position was not received yet).
+     */
+    static const unsigned int HIDDEN = 1 << 0;
+
+    /**
+     * @brief Constructs an empty SpritePool object with the specified capacity.
+     *
+     * @param capacity The maximum number of sprites in the pool.
+     */
+    SpritePool(int capacity);
+
+    /**
+     * @brief Adds a sprite to the pool.
+     *
+     * @param x The x-coordinate of the sprite.
+     * @param y The y-coordinate of the sprite.
+     * @param textureId The index of the texture of the sprite.
+     * @param flags The flags of the sprite.
+     * @return The id of the sprite.
+     */
+    int add(double x, double y, int textureId, unsigned int flags);
+
+    /**
+     * @brief Removes a sprite from the pool. The last slot is moved into the slot of the removed sprite.
+     *
+     * @param id The id of the sprite.
+     */
+    void remove(int id);
+
+    /**
+     * @brief Moves a sprite to the specified position.
+     *
+     * @param id The id of the sprite.
+     * @param x The x-coordinate of the new position.
+     * @param y The y-coordinate of the new position.
+     */
+    void move(int id, double x, double y);
+
+    /**
+     * @brief Sets the flags of a sprite.
+     *
+     * @param id The id of the sprite.
+     * @param flags The new flags of the sprite.
+     */
+    void setFlags(int id, unsigned int flags);
+
+    /**
+     * @brief Gets the number of sprites in the pool.
+     *
+     * @return The number of sprites.
+     */
+    int size() const;
+
+    /**
+     * @brief Gets the maximum number of sprites in the pool.
+     *
+     * @return The capacity of the pool.
+     */
+    int capacity() const;
+
+    /**
+     * @brief Gets the slot of a sprite.
+     *
+     * @param id The id of the sprite.
+     * @return The slot of the sprite.
+     */
+    int slotOf(int id) const;
+
+    /**
+     * @brief Gets the id of the sprite in a slot.
+     *
+     * @param slot The slot of the sprite.
+     * @return The id of the sprite.
+     */
+    int idOf(int slot) const;
+
+    /**
+     * @brief Gets the x-coordinates of the sprites.
+     *
+     * @return The array of the x-coordinates, by slot.
+     */
+    const double *x() const;
+
+    /**
+     * @brief Gets the y-coordinates of the sprites.
+     *
+     * @return The array of the y-coordinates, by slot.
+     */
+    const double *y() const;
+
+    /**
+     * @brief Gets the texture indexes of the sprites.
+     *
+     * @return The array of the texture indexes, by slot.
+     */
+    const int *textureId() const;
+
+    /**
+     * @brief Gets the flags of the sprites.
+     *
+     * @return The array of the flags, by slot.
+     */
+    const unsigned int *flags() const;
+
+    /**
+     * @brief Projects all the sprites on the screen, as seen from the specified camera.
+     * The loop runs over the packed slots without branches on the sprites so that it is vectorized.
+     *
+     * @param posX The x-coordinate of the camera.
+     * @param posY The y-coordinate of the camera.
+     * @param dirX The x-component of the direction of the camera.
+     * @param dirY The y-component of the direction of the camera.
+     * @param camX The x-component of the camera plane.
+     * @param camY The y-component of the camera plane.
+     * @param screenWidth The width of the screen.
+     * @param screenHeight The height of the screen.
+     * @param projections The projections, indexed by slot (resized to the capacity of the pool beforehand).
+     */
+    void project(double posX, double posY, double dirX, double dirY, double camX, double camY,
+                 int screenWidth, int screenHeight, SpriteProjections &projections) const;
+
+private:
+    int count;                          // The number of sprites in the pool.
+    std::vector<double> xs, ys;         // The positions of the sprites, by slot.
+    std::vector<int> textureIds;        // The texture indexes of the sprites, by slot.
+    std::vector<unsigned int> flagBits; // The flags of the sprites, by slot.
+    std::vector<int> slotIds;           // The id of the sprite in every slot.
+    std::vector<int> idSlots;           // The slot of every id (-1 for a free id).
+    std::vector<int> freeIds;           // The stack of the free ids.
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SPRITESORTER_H
+#define SPRITESORTER_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief Counters of the strategies used by a SpriteSorter.
+ */
+struct SortStats
+{
+    long repairs = 0;         // The number of sorts done by repairing the previous order with an insertion sort.
+    long radixSorts = 0;      // The number of sorts done with a radix sort on the float keys.
+    long comparisonSorts = 0; // The number of sorts done with a comparison sort.
+};
+
+/**
+ * @brief Sorts the sprites from the farthest to the nearest, reusing the order of the previous frame.
+ *
+ * The sprites barely move between two frames, so the previous order is almost sorted: it is repaired with an
+ * insertion sort, as long as the number of moved entries stays small. Otherwise, the sprites are sorted from scratch,
+ * with a radix sort on their distance (as a float) when there are many of them. All the buffers are allocated once.
+ *
+ * Whatever the strategy, the sprites at the same distance are sorted by increasing index, so that the order only
+ * depends on the distances.
+ */
+class SpriteSorter
+{
+public:
+    /**
+     * @brief Constructs a SpriteSorter object for the specified number of sprites.
+     *
+     * @param capacity The maximum number of sprites, and the bound of their indexes.
+     */
+    SpriteSorter(int capacity);
+
+    /**
+     * @brief Sorts the sprites from the farthest to the nearest.
+     *
+     * @param order The indexes of the sprites to sort, sorted in place.
+     * @param distance The distances of the sprites (non-negative), in the same order as the indexes, sorted in place.
+     * @param n The number of sprites to sort.
+     */
+    void sort(int *order, double *distance, int n);
+
+    /**
+     * @brief Gets the counters of the strategies used so far.
+     *
+     * @return The sort statistics.
+     */
+    const SortStats &getStats() const;
+
+    static const int radixThreshold = 256; // The number of sprites from which the radix sort is used.
+    static const int repairBudget = 4;     // The number of insertion shifts allowed per sprite before giving up the repair.
+
+private:
+    /**
+     * @brief What the sorter knows about a sprite, grouped so that a lookup by index touches a single cache line.
+     */
+    struct Entry
+    {
+        unsigned int present; // The frame in which the sprite was last given to sort.
+        unsigned int placed;  // The frame in which the sprite was last placed in the candidates.
+        double distance;      // The distance of the sprite given in the last frame it was present.
+    };
+
+    std::vector<Entry> entries;                // What is known about every sprite, by index.
+    std::vector<int> previousOrder;            // The order of the previous frame.
+    int previousCount;                         // The number of sprites sorted in the previous frame.
+    std::vector<int> candidates;               // The order being sorted.
+    std::vector<double> candidateDistances;    // The distances of the candidates, moved along with them.
+    unsigned int frame;                        // The number of sorts done.
+    std::vector<uint64_t> keys, keysTmp;       // The radix keys (with the positions of the candidates), and the buffer of a radix pass.
+    std::vector<int> candidatesTmp;            // The buffer of the candidates reordered by the radix sort.
+    std::vector<double> candidateDistancesTmp; // The buffer of the distances reordered by the radix sort.
+    std::vector<std::pair<double, int>> pairs; // The buffer of the comparison sort.
+    SortStats stats;                           // The counters of the strategies used.
+
+    /**
+     * @brief Sorts the candidates with an insertion sort, unless it takes more shifts than the budget.
+     *
+     * @param n The number of candidates.
+     * @param budget The most shifts allowed.
+     * @return True if the candidates were sorted, false if the budget was exceeded.
+     */
+    bool repair(int n, long budget);
+
+    /**
+     * @brief Sorts the candidates with a LSD radix sort on their distance, converted to a float, then orders the
+     * candidates whose distances round to the same float.
+     *
+     * @param n The number of candidates.
+     */
+    void radixSort(int n);
+};
+
+#endif
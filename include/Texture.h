@@ -2,9 +2,43 @@
 #define TEXTURE_H
 
 #include <vector>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief The orders in which the texels of a texture are stored.
+ */
+enum class TextureLayout
+{
+    ROW_MAJOR,    // Row after row: suits horizontal walks.
+    COLUMN_MAJOR, // Column after column: suits the vertical walks of the walls and sprites.
+    MORTON,       // Z-order: the texels close in both directions are close in memory, whatever the direction of the walk.
+};
+
+template <typename Color, bool Indexed>
+class TextureSampler;
 
 /**
  * @brief The Texture class represents a texture.
+ *
+ * Darker copies of the pixels are precomputed as shade levels. Every shadesPerHalving levels halve the brightness, so
+ * the side darkening of the walls is an offset of shadesPerHalving levels, and can be combined with the light falloff
+ * of the distance by adding levels. Only the first storedShades levels are stored: the darker ones are the stored level
+ * with the same remainder with its channels halved by a shift and a mask at sample time, so that a 64x64 texture takes
+ * 64 KB instead of 256 KB.
+ *
+ * A texture can be palettized: its pixels are then stored as 8-bit indexes in a palette of at most 256 colors, and only
+ * the palette is shaded, at all the shade levels. A 64x64 texture then takes 4 KB plus 1 KB per shade level.
+ *
+ * For the 16-bit framebuffers, the shade levels (or the shaded palettes) can also be converted once to RGB565, so that
+ * the texels are written to the framebuffer without any conversion.
+ *
+ * The pixels of all the shade levels can also be used in place from a read-only mapping (see AssetPack): they are then
+ * shared by the copies of the texture, and only copied if the texture is changed.
+ *
+ * get and get565 find out the storage of the texture at every call: the drawing loops read the texels through a
+ * TextureSampler instead, chosen once per column or row.
  */
 class Texture
 {
@@ -30,6 +64,42 @@ public:
      */
     Texture(int width, int height, const unsigned int *pixels, bool isVertical);
 
+    /**
+     * @brief Constructs a Texture object with the specified width, height, pixels, and layout.
+     *
+     * @param width The width of the texture (a power of 2).
+     * @param height The height of the texture (a power of 2).
+     * @param pixels An array of pixels representing the texture, row after row. These values are copied to the texture.
+     * @param layout The order in which the texels are stored.
+     */
+    Texture(int width, int height, const unsigned int *pixels, TextureLayout layout);
+
+    /**
+     * @brief Constructs a Texture object using pixels already shaded and stored in their layout, without copying them.
+     *
+     * @param width The width of the texture (a power of 2).
+     * @param height The height of the texture (a power of 2).
+     * @param layout The order in which the texels are stored.
+     * @param texels The pixels of the stored shade levels, one after the other, as returned by getTexels.
+     * @param mapping The owner of the pixels, kept alive as long as a copy of the texture uses them.
+     */
+    Texture(int width, int height, TextureLayout layout, const unsigned int *texels, std::shared_ptr<const void> mapping);
+
+    /**
+     * @brief Constructs a copy of a texture. Mapped pixels are shared, not copied.
+     *
+     * @param other The texture to copy.
+     */
+    Texture(const Texture &other);
+
+    /**
+     * @brief Replaces the texture by a copy of another one. Mapped pixels are shared, not copied.
+     *
+     * @param other The texture to copy.
+     * @return This texture.
+     */
+    Texture &operator=(const Texture &other);
+
     /**
      * @brief Gets the pixel value at the specified coordinates.
      *
@@ -39,6 +109,50 @@ public:
      */
     unsigned int get(int x, int y) const;
 
+    /**
+     * @brief Gets the pixel value at the specified coordinates, at a shade level.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param shade The shade level, in [0, shadeLevels).
+     * @return The pixel value at the specified coordinates, darkened to the shade level.
+     */
+    unsigned int get(int x, int y, int shade) const;
+
+    /**
+     * @brief Gets the RGB565 pixel value at the specified coordinates, at a shade level (only available once
+     * prepareRGB565 was called).
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param shade The shade level, in [0, shadeLevels).
+     * @return The pixel value at the specified coordinates, darkened to the shade level and converted to RGB565.
+     */
+    unsigned short get565(int x, int y, int shade) const;
+
+    /**
+     * @brief Converts the shade levels (or the shaded palettes of an indexed texture) to RGB565, for get565.
+     * Calling it again does nothing. The RGB565 copy follows the later palettization and layout changes.
+     */
+    void prepareRGB565();
+
+    /**
+     * @brief Converts a color to RGB565, by truncating the channels to 5, 6 and 5 bits.
+     *
+     * @param color The color, as 0xRRGGBB.
+     * @return The RGB565 color.
+     */
+    static unsigned short toRGB565(unsigned int color);
+
+    /**
+     * @brief Converts a RGB565 color to 0xRRGGBB, by replicating the high bits of every channel in its low bits.
+     * Converting the result back to RGB565 gives the same color.
+     *
+     * @param color The RGB565 color.
+     * @return The color, as 0xRRGGBB.
+     */
+    static unsigned int fromRGB565(unsigned short color);
+
     /**
      * @brief Gets the width of the texture.
      *
@@ -53,11 +167,215 @@ public:
      */
     int getHeight() const;
 
+    /**
+     * @brief Converts the texture to indexed colors: the colors are quantized to a palette of at most 256 colors
+     * (exactly when the texture has no more colors), and the pixels replaced by their index in the palette.
+     * Black, the invisible color of the sprites, is kept exact, and no other color is quantized to it.
+     */
+    void palettize();
+
+    /**
+     * @brief Checks if the texture is stored as indexed colors.
+     *
+     * @return True if the texture was palettized, false otherwise.
+     */
+    bool isIndexed() const;
+
+    /**
+     * @brief Gets the memory taken by the pixels of the texture, with their stored shade levels.
+     *
+     * @return The size of the pixels in bytes.
+     */
+    size_t getMemorySize() const;
+
+    /**
+     * @brief Changes the order in which the texels are stored. The texture looks the same.
+     *
+     * @param layout The new layout.
+     */
+    void setLayout(TextureLayout layout);
+
+    /**
+     * @brief Gets the order in which the texels are stored.
+     *
+     * @return The layout of the texture.
+     */
+    TextureLayout getLayout() const;
+
+    /**
+     * @brief Gets the pixels of the stored shade levels one after the other, as stored.
+     *
+     * @return The pixels, or NULL if the texture is indexed.
+     */
+    const unsigned int *getTexels() const;
+
+    /**
+     * @brief Checks if the pixels of the texture are used in place from a mapping.
+     *
+     * @return True if the pixels are mapped, false if the texture owns them.
+     */
+    bool isMapped() const;
+
+    /**
+     * @brief Copies the mapped pixels into the texture, which then owns them: reading them cannot fault on the mapping.
+     * Does nothing if the texture already owns its pixels.
+     */
+    void copyPixels();
+
+    /**
+     * @brief Makes a smaller copy of the texture, every texel being the mean color of the block of texels it covers.
+     *
+     * @param width The width of the copy (a power of 2, at most the width of the texture).
+     * @param height The height of the copy (a power of 2, at most the height of the texture).
+     * @return The smaller texture, in the same layout, not indexed.
+     */
+    Texture downsampled(int width, int height) const;
+
+    static const int shadeLevels = 16;                // The number of shade levels, the first one being the texture itself.
+    static const int shadesPerHalving = 4;            // The number of shade levels halving the brightness.
+    static const int storedShades = shadesPerHalving; // The number of shade levels stored, the others being derived by halving.
+
+private:
+    int width;                               // The width of the texture.
+    int height;                              // The height of the texture.
+    std::vector<unsigned int> pixels;        // The array of pixels representing the texture, for every stored shade level one after the other (empty if mapped).
+    const unsigned int *texels;              // The pixels used: the owned ones or the mapped ones (NULL if indexed).
+    std::shared_ptr<const void> mapping;     // The owner of the mapped pixels (NULL if the texture owns its pixels).
+    TextureLayout layout;                    // The order in which the texels are stored.
+    std::vector<int> mortonX, mortonY;       // The bits of every column and row spread to their place in the Z-order.
+    std::vector<int> columnOffsets;          // The position of every column in the storage of a shade level, in the layout.
+    std::vector<int> rowOffsets;             // The position of every row in the storage of a shade level, in the layout.
+    std::vector<unsigned char> indexes;      // The palette index of every pixel, in the same order as the pixels (if indexed).
+    std::vector<unsigned int> palettes;      // The palette, for every shade level one after the other (if indexed).
+    std::vector<unsigned short> pixels565;   // The pixels converted to RGB565, as the pixels (if prepared and not indexed).
+    std::vector<unsigned short> palettes565; // The palettes converted to RGB565 (if prepared and indexed).
+    bool hasRGB565;                          // Whether the RGB565 copy is kept.
+
+    /**
+     * @brief Gets the position of a texel in the storage of a shade level.
+     *
+     * @param x The x-coordinate of the texel, in [0, width).
+     * @param y The y-coordinate of the texel, in [0, height).
+     * @param layout The layout of the storage.
+     * @return The position of the texel.
+     */
+    int offset(int x, int y, TextureLayout layout) const;
+
+    /**
+     * @brief Computes the positions of the columns and rows in the Z-order.
+     */
+    void buildMorton();
+
+    /**
+     * @brief Computes the positions of the columns and rows in the layout of the texture.
+     */
+    void buildOffsets();
+
+    /**
+     * @brief Gets the texels of a shade level, or its palette if the texture is indexed. The texels of a level that is
+     * not stored are those of a stored level shifted right and masked.
+     *
+     * @param shade The shade level, in [0, shadeLevels).
+     * @param colors Set to the texels of the stored level or the palette.
+     * @param shift Set to the right shift of the colors (0 if indexed).
+     * @param mask Set to the mask of the shifted colors, clearing the bits shifted into another channel.
+     */
+    void getPlane(int shade, const unsigned int *&colors, int &shift, unsigned int &mask) const;
+
+    /**
+     * @brief Gets the RGB565 texels of a shade level, or its RGB565 palette if the texture is indexed.
+     *
+     * @param shade The shade level, in [0, shadeLevels).
+     * @param colors Set to the texels of the stored level or the palette.
+     * @param shift Set to the right shift of the colors (0 if indexed).
+     * @param mask Set to the mask of the shifted colors, clearing the bits shifted into another channel.
+     */
+    void getPlane(int shade, const unsigned short *&colors, int &shift, unsigned short &mask) const;
+
+    /**
+     * @brief Computes the stored shade levels from the pixels of the first level.
+     */
+    void buildShades();
+
+    /**
+     * @brief Computes the RGB565 copy from the pixels or the palettes.
+     */
+    void buildRGB565();
+
+    /**
+     * @brief Quantizes a list of colors to a palette with a median cut: the box of colors with the widest range on a
+     * channel is split at its median until there are enough boxes, and every box is replaced by its mean color.
+     *
+     * @param colors The distinct colors with their number of pixels, reordered.
+     * @param size The number of colors of the palette.
+     * @return The palette.
+     */
+    static std::vector<unsigned int> medianCut(std::vector<std::pair<unsigned int, int>> &colors, int size);
+
+    template <typename Color, bool Indexed>
+    friend class TextureSampler;
+};
+
+/**
+ * @brief Reads the texels of a texture at a shade level, the format of the texels and the storage of the texture being
+ * fixed by the type: chosen once for a column or a row, the fetches of its texels do not branch.
+ *
+ * The layout of the texture is folded into the positions of its columns and rows, a texel being at the sum of the
+ * positions of its column and row whatever the layout. The drawing loops take their samplers by value: the stores to
+ * the frame cannot alias a local copy, whose fields then stay in registers.
+ *
+ * @tparam Color unsigned int to read the texels as 0xRRGGBB, unsigned short to read them as RGB565 (once prepareRGB565
+ * was called).
+ * @tparam Indexed Whether the texture is indexed.
+ */
+template <typename Color, bool Indexed>
+class TextureSampler
+{
+public:
+    /**
+     * @brief Constructs a TextureSampler object reading a texture at a shade level.
+     *
+     * @param texture The texture, which must not change while it is sampled.
+     * @param shade The shade level, in [0, Texture::shadeLevels).
+     */
+    TextureSampler(const Texture &texture, int shade);
+
+    /**
+     * @brief Gets the texel at the specified coordinates, wrapped to the size of the texture.
+     *
+     * @param x The x-coordinate of the texel.
+     * @param y The y-coordinate of the texel.
+     * @return The texel, darkened to the shade level.
+     */
+    Color get(int x, int y) const;
+
 private:
-    int width;                        // The width of the texture.
-    int height;                       // The height of the texture.
-    std::vector<unsigned int> pixels; // The array of pixels representing the texture.
-    bool isVertical;                  // Whether the texture is stored vertically.
+    const Color *colors;          // The texels of the stored shade level, or its palette if the texture is indexed.
+    const unsigned char *indexes; // The palette index of every texel (if indexed).
+    const int *columns;           // The position of every column.
+    const int *rows;              // The position of every row.
+    int widthMask;                // The width of the texture minus 1.
+    int heightMask;               // The height of the texture minus 1.
+    int shift;                    // The right shift halving the texels to the shade level (0 if indexed).
+    Color mask;                   // The mask of the shifted texels.
 };
 
+template <typename Color, bool Indexed>
+TextureSampler<Color, Indexed>::TextureSampler(const Texture &texture, int shade)
+    : indexes(texture.indexes.data()),
+      columns(texture.columnOffsets.data()),
+      rows(texture.rowOffsets.data()),
+      widthMask(texture.width - 1),
+      heightMask(texture.height - 1)
+{
+    texture.getPlane(shade, colors, shift, mask);
+}
+
+template <typename Color, bool Indexed>
+inline Color TextureSampler<Color, Indexed>::get(int x, int y) const
+{
+    int i = columns[x & widthMask] + rows[y & heightMask];
+    return Indexed ? colors[indexes[i]] : Color(colors[i] >> shift & mask);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <AssetPack.h>
+#include <Texture.h>
+
+/**
+ * @brief Counters of the lookups and the residency changes of a TextureCache.
+ */
+struct TextureCacheStats
+{
+    long hits = 0;            // The number of lookups of a resident texture.
+    long misses = 0;          // The number of lookups answered with a placeholder.
+    long loads = 0;           // The number of textures made resident.
+    long evictions = 0;       // The number of textures evicted to stay within the budget.
+    long oversized = 0;       // The number of textures larger than the whole budget, drawn with their placeholder.
+    size_t residentBytes = 0; // The memory taken by the resident textures.
+};
+
+/**
+ * @brief Writes a summary of the counters of a texture cache.
+ * @param os The stream to write to.
+ * @param stats The counters of the cache.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const TextureCacheStats &stats);
+
+/**
+ * @brief Keeps the textures of an asset pack resident within a fixed memory budget, evicting the least recently used.
+ *
+ * Looking up a texture never blocks: a texture that is not resident is requested from a background thread, which
+ * copies it from the pack (the disk reads happen there), and a low-resolution placeholder is returned meanwhile. The
+ * residency only changes in update, called between two frames: the textures returned by get stay valid during the
+ * frame, and can be looked up from several threads. A texture larger than the whole budget is never made resident:
+ * its placeholder is drawn instead, rather than loading and evicting it on every lookup.
+ */
+class TextureCache
+{
+public:
+    /**
+     * @brief Constructs a TextureCache object and starts its loading thread. No texture is resident at first.
+     *
+     * @param pack The asset pack holding the textures.
+     * @param names The names of the textures in the pack, the id of a texture being its index in the list.
+     * @param budget The memory the resident textures may take, in bytes.
+     */
+    TextureCache(std::shared_ptr<const AssetPack> pack, const std::vector<std::string> &names, size_t budget);
+
+    /**
+     * @brief Stops the loading thread.
+     */
+    ~TextureCache();
+
+    /**
+     * @brief Gets a texture if it is resident, or requests it and gets its placeholder otherwise.
+     *
+     * @param id The id of the texture.
+     * @return The texture or its placeholder, valid until the next update.
+     */
+    const Texture &get(int id);
+
+    /**
+     * @brief Makes the loaded textures resident, then evicts the least recently used ones until the budget is met.
+     * Must be called between two frames, when no texture of the cache is in use.
+     */
+    void update();
+
+    /**
+     * @brief Applies a conversion (e.g. palettization) to the placeholders, to the resident textures, and to every
+     * texture loaded afterwards. Must be called between two frames.
+     *
+     * @param conversion The conversion of a texture.
+     */
+    void convert(const std::function<void(Texture &)> &conversion);
+
+    /**
+     * @brief Gets the counters of the cache.
+     *
+     * @return The counters since the creation of the cache.
+     */
+    TextureCacheStats getStats() const;
+
+    /**
+     * @brief Gets the name of the placeholder of a texture in an asset pack. If the pack has no placeholder for the
+     * texture, it is downsampled from the texture when the cache is created.
+     *
+     * @param name The name of the texture.
+     * @return The name of its placeholder.
+     */
+    static std::string placeholderName(const std::string &name);
+
+    static const int placeholderSize = 8; // The width and height of the placeholders.
+
+private:
+    /**
+     * @brief A texture loaded by the loading thread, waiting to be made resident.
+     */
+    struct LoadedTexture
+    {
+        int id;                           // The id of the texture.
+        std::unique_ptr<Texture> texture; // The texture.
+        int conversions;                  // The number of conversions already applied to the texture.
+    };
+
+    std::shared_ptr<const AssetPack> pack;          // The asset pack holding the textures.
+    std::vector<std::string> names;                 // The names of the textures in the pack, by id.
+    size_t budget;                                  // The memory the resident textures may take, in bytes.
+    std::vector<Texture> placeholders;              // The placeholder of every texture, by id (always resident).
+    std::vector<std::unique_ptr<Texture>> resident; // The resident textures, by id (NULL if not resident).
+    std::vector<std::atomic<long>> lastUsed;        // The frame every texture was last looked up in, by id.
+    std::vector<std::atomic<bool>> requested;       // Whether every texture is requested, loaded but not resident yet, or too large.
+    long frame;                                     // The number of updates so far.
+    std::atomic<long> hits, misses;                 // The lookups of resident and of missing textures.
+    long loads, evictions, oversized;               // The numbers of textures made resident, evicted and too large.
+    size_t residentBytes;                           // The memory taken by the resident textures.
+
+    std::vector<std::function<void(Texture &)>> conversions; // The conversions applied to the textures, in order.
+    std::deque<int> requests;                                // The ids of the textures to load, oldest first.
+    std::vector<LoadedTexture> loaded;                       // The textures loaded since the last update.
+    bool stopping;                                           // Whether the loading thread must stop.
+    std::mutex mutex;                                        // Protects the conversions, requests, loaded textures and stopping flag.
+    std::condition_variable requestAdded;                    // Notified when a texture is requested or the cache stops.
+    std::thread loader;                                      // The loading thread.
+
+    /**
+     * @brief Loads the requested textures until the cache stops (run by the loading thread).
+     */
+    void loadRequests();
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef UDPFANOUTSENDER_H
+#define UDPFANOUTSENDER_H
+
+#include <cstdint>
+#include <netinet/in.h>
+#include <ostream>
+#include <sys/socket.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <PositionPacket.h>
+
+/**
+ * @brief Counters of the fan-outs of a UDPFanoutSender.
+ */
+struct SendStats
+{
+    long batches = 0;        // The number of fan-outs (one payload sent to all the destinations).
+    long syscalls = 0;       // The number of sendmmsg calls.
+    long packets = 0;        // The number of datagrams sent.
+    long failures = 0;       // The number of datagrams that could not be sent.
+    double totalLatency = 0; // The total time spent submitting the fan-outs (s).
+    double maxLatency = 0;   // The longest time spent submitting a fan-out (s).
+};
+
+/**
+ * @brief Writes a summary of the counters of a sender.
+ * @param os The stream to write to.
+ * @param stats The counters of the sender.
+ * @return The stream.
+ */
+std::ostream &operator<<(std::ostream &os, const SendStats &stats);
+
+/**
+ * @brief Sends the same payload to many destinations through a single socket.
+ *
+ * The payload is encoded once in a buffer shared by all the messages, and the whole fan-out is submitted with
+ * sendmmsg: one system call for up to 1024 destinations instead of one per destination. The messages are built once.
+ */
+class UDPFanoutSender
+{
+public:
+    /**
+     * @brief Constructs a UDPFanoutSender object with the specified destinations.
+     *
+     * @param destinations The IP addresses and ports to send the packets to.
+     */
+    UDPFanoutSender(const std::vector<std::pair<std::string, int>> &destinations);
+
+    /**
+     * @brief Destroys the UDPFanoutSender object and closes the socket.
+     */
+    ~UDPFanoutSender();
+
+    /**
+     * @brief Sends a payload to all the destinations.
+     *
+     * @param data The payload.
+     * @param length The size of the payload in bytes (at most maxPayload).
+     */
+    void send(const void *data, int length);
+
+    /**
+     * @brief Sends a position packet to all the destinations, encoding it straight into the shared buffer.
+     *
+     * @param packet The packet to send.
+     */
+    void send(const PositionPacket &packet);
+
+    /**
+     * @brief Sends a position packet to some of the destinations.
+     *
+     * @param packet The packet to send.
+     * @param indexes The indexes of the destinations, in the order they were given to the constructor.
+     */
+    void send(const PositionPacket &packet, const std::vector<int> &indexes);
+
+    /**
+     * @brief Sends a position packet to some of the destinations, every destination numbering its packets on its own:
+     * the updates are encoded once, and every destination is sent its own header.
+     *
+     * @param packet The packet to send, whose sequence number is ignored.
+     * @param indexes The indexes of the destinations, in the order they were given to the constructor.
+     * @param sequences The sequence number of the next packet of every destination, by index, incremented for the
+     * destinations sent to.
+     */
+    void send(const PositionPacket &packet, const std::vector<int> &indexes, std::vector<uint32_t> &sequences);
+
+    /**
+     * @brief Gets the number of destinations.
+     *
+     * @return The number of destinations.
+     */
+    int getDestinationCount() const;
+
+    /**
+     * @brief Gets the counters of the sender.
+     *
+     * @return The counters since the creation of the sender.
+     */
+    const SendStats &getStats() const;
+
+    static const int maxPayload = 1472; // The largest payload sent (the largest UDP payload in an Ethernet frame).
+
+private:
+    int sockfd;                            // The socket file descriptor.
+    std::vector<sockaddr_in> destinations; // The addresses of the destinations.
+    unsigned char buffer[maxPayload];      // The payload, shared by all the messages.
+    iovec payload;                         // The buffer of all the messages.
+    std::vector<mmsghdr> messages;         // The message of every destination.
+    std::vector<mmsghdr> selected;         // The messages of the destinations of a partial fan-out.
+    std::vector<unsigned char> headers;    // The header of every destination, for the packets numbered per destination.
+    std::vector<iovec> numbered;           // The header of every destination followed by the shared updates.
+    SendStats stats;                       // The counters of the sender.
+
+    /**
+     * @brief Sends the payload in the buffer with a batch of messages.
+     *
+     * @param length The size of the payload in bytes.
+     * @param batch The messages, one per destination.
+     * @param count The number of messages.
+     */
+    void sendBuffer(int length, mmsghdr *batch, int count);
+};
+
+#endif
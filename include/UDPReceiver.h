@@ -2,12 +2,37 @@
 #define UDPRECEIVER_H
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 #include <string>
+#include <vector>
 
-#include <Vector.h>
+/**
+ * @brief A datagram received by a UDPReceiver, stored in its preallocated ring.
+ */
+struct ReceivedPacket
+{
+    sockaddr_in from;         // The address of the sender.
+    int length;               // The number of bytes received (truncated to the size of the data).
+    unsigned char data[1472]; // The payload (the largest UDP payload that fits in an Ethernet frame).
+};
+
+/**
+ * @brief Counters of the wake-ups and system calls of a UDPReceiver.
+ */
+struct ReceiveStats
+{
+    long waits = 0;     // The number of waits for data.
+    long wakeups = 0;   // The number of waits that ended because data arrived.
+    long batches = 0;   // The number of recvmmsg calls that returned packets.
+    long packets = 0;   // The number of packets received.
+    long truncated = 0; // The number of packets larger than the buffer of a packet.
+};
 
 /**
  * @brief The UDPReceiver class is responsible for receiving position data using the UDP protocol.
+ *
+ * The receiver sleeps in epoll until data arrives, then drains the socket with recvmmsg: many datagrams per system
+ * call, written into a ring of packets allocated once.
  */
 class UDPReceiver
 {
@@ -18,22 +43,52 @@ public:
      */
     UDPReceiver(int port);
 
+    /**
+     * @brief Constructs a UDPReceiver object with the specified port and number of packets received at once.
+     * @param port The port number to listen on (0 for any free port).
+     * @param capacity The number of packets of the ring, i.e. the most packets returned by a call to receive.
+     */
+    UDPReceiver(int port, int capacity);
+
     /**
      * @brief Destroys the UDPReceiver object and closes the socket.
      */
     ~UDPReceiver();
 
     /**
-     * @brief Receives a UDP packet and returns the received position.
-     * @return A pair containing: 1. the sender's IP address concatenated with the port number 2. the received position.
+     * @brief Waits until data arrives or the timeout expires, then receives all the pending packets (up to the capacity).
+     * @param timeoutMs The longest wait in milliseconds (-1 to wait forever, 0 to only drain the pending packets).
+     * @return The number of packets received, available through getPacket until the next call.
+     */
+    int receive(int timeoutMs);
+
+    /**
+     * @brief Gets a packet received by the last call to receive.
+     * @param i The index of the packet, in [0, the number of packets received).
+     * @return The packet.
+     */
+    const ReceivedPacket &getPacket(int i) const;
+
+    /**
+     * @brief Gets the port the socket is bound to (useful when bound to port 0).
+     * @return The port.
+     */
+    int getPort() const;
+
+    /**
+     * @brief Gets the counters of the receiver.
+     * @return The counters since the creation of the receiver.
      */
-    std::pair<std::string, Vector<double>> receive();
+    const ReceiveStats &getStats() const;
 
 private:
     int sockfd;                          // The socket file descriptor.
-    double buffer[2];                    // The buffer to store the received data.
-    int bufferSize = 2 * sizeof(double); // The size of the buffer.
+    int epollfd;                         // The epoll instance waiting for the socket to be readable.
     sockaddr_in addr;                    // The address structure for the socket.
+    std::vector<ReceivedPacket> packets; // The ring of packets, filled from the start by every call to receive.
+    std::vector<mmsghdr> headers;        // The headers of recvmmsg, pointing into the packets.
+    std::vector<iovec> vectors;          // The buffers of recvmmsg, one per packet.
+    ReceiveStats stats;                  // The counters of the receiver.
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,54 @@
+#ifndef WALLSEGMENTS_H
+#define WALLSEGMENTS_H
+
+#include <vector>
+
+#include <Map.h>
+
+/**
+ * @brief Represents a straight run of wall faces between empty and wall cells of the map.
+ */
+struct WallSegment
+{
+    int side;       // 0 if the face lies on the line x = coord (NS wall), 1 if it lies on the line y = coord (EW wall).
+    int coord;      // The constant coordinate of the line the face lies on.
+    int start, end; // The range [start, end) covered by the face along the other axis.
+    int facing;     // +1 if the wall cells are on the positive side of the line (seen by rays stepping +1), -1 otherwise.
+};
+
+/**
+ * @brief The WallSegments class extracts the wall faces of a map as merged segments.
+ *
+ * Consecutive unit faces lying on the same line and facing the same way are merged into a single segment,
+ * so that a long wall is projected once instead of once per cell.
+ */
+class WallSegments
+{
+public:
+    /**
+     * @brief Constructs a WallSegments object by extracting the wall faces of the specified map.
+     *
+     * @param map The map to extract the wall faces from.
+     */
+    WallSegments(const Map &map);
+
+    /**
+     * @brief Gets the list of extracted segments.
+     *
+     * @return The list of segments.
+     */
+    const std::vector<WallSegment> &get() const;
+
+private:
+    std::vector<WallSegment> segments; // The list of extracted segments.
+
+    /**
+     * @brief Extracts the segments lying on the lines of constant coordinate along the specified side.
+     *
+     * @param map The map to extract the wall faces from.
+     * @param side 0 to extract the faces on the lines x = constant, 1 for the lines y = constant.
+     */
+    void extract(const Map &map, int side);
+};
+
+#endif
@@ -11,6 +11,15 @@
 #include <Average.h>
 #include <Texture.h>
 
+/**
+ * @brief The formats of the pixels of the frames being drawn.
+ */
+enum class FramebufferFormat
+{
+    RGB888, // 32 bits per pixel, as 0xRRGGBB.
+    RGB565, // 16 bits per pixel: half the memory traffic, converted to 32 bits only if the display needs it.
+};
+
 /**
  * @brief Manages the window and graphics operations.
  *
@@ -28,6 +37,24 @@ public:
      */
     WindowManager(int width, int height);
 
+    /**
+     * @brief Constructs a WindowManager object with the specified width and height, optionally without a window.
+     * @param width The width of the window.
+     * @param height The height of the window.
+     * @param headless Whether to only render into the image buffer, without connecting to the X server (used for benchmarks).
+     */
+    WindowManager(int width, int height, bool headless);
+
+    /**
+     * @brief Constructs a WindowManager object with the specified width, height and format of the frames.
+     * @param width The width of the window.
+     * @param height The height of the window.
+     * @param headless Whether to only render into the image buffer, without connecting to the X server (used for benchmarks).
+     * @param format The format of the pixels of the frames. A RGB565 frame is shown as is on a 16-bit RGB565 display,
+     * and converted to 32 bits when it is flushed otherwise.
+     */
+    WindowManager(int width, int height, bool headless, FramebufferFormat format);
+
     /**
      * @brief Destructor for the WindowManager object.
      */
@@ -51,6 +78,12 @@ public:
      */
     int getHeight() const;
 
+    /**
+     * @brief Gets the format of the pixels of the frames.
+     * @return The format of the frames.
+     */
+    FramebufferFormat getFormat() const;
+
     /**
      * @brief Draws a vertical line on the window.
      * @param x The x-coordinate of the line on the window.
@@ -59,18 +92,58 @@ public:
      * @param lineHeight The height of the line.
      * @param texture The texture to use for drawing the line.
      * @param texX The x-coordinate of the texture to start drawing from.
-     * @param darken Whether to darken the line or not.
+     * @param shade The shade level of the texture to draw the line with.
+     * @param yStep The distance between two drawn pixels of the line (2 to only draw every other pixel).
+     * The texture must be prepared for RGB565 if the frames are RGB565.
      */
-    void drawVertLine(int x, int yStart, int yEnd, int lineHeight, Texture &texture, int texX, bool darken);
+    void drawVertLine(int x, int yStart, int yEnd, int lineHeight, const Texture &texture, int texX, int shade, int yStep);
 
     /**
      * @brief Draws a pixel on the window.
      * @param x The x-coordinate of the pixel.
      * @param y The y-coordinate of the pixel.
-     * @param color The color of the pixel.
+     * @param color The color of the pixel, as 0xRRGGBB (converted if the frames are RGB565).
      */
     void drawPixel(int x, int y, unsigned int color);
 
+    /**
+     * @brief Draws a RGB565 pixel on the window (only if the frames are RGB565).
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param color The RGB565 color of the pixel.
+     */
+    void drawPixel565(int x, int y, unsigned short color);
+
+    /**
+     * @brief Draws a 0xRRGGBB pixel on the window (only if the frames are RGB888).
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param color The color of the pixel.
+     */
+    void drawPixel888(int x, int y, unsigned int color);
+
+    /**
+     * @brief Gets a pixel of the frame being drawn, as 0xRRGGBB (expanded if the frames are RGB565).
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return The color of the pixel.
+     */
+    unsigned int getPixel(int x, int y) const;
+
+    /**
+     * @brief Enables keeping the previous frame: the window then uses two buffers, swapped on every flush.
+     * Once enabled, the buffer of the new frame holds the frame before the previous one.
+     */
+    void keepPreviousFrame();
+
+    /**
+     * @brief Gets a pixel of the previous frame (only available once keepPreviousFrame was called).
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return The color of the pixel in the previous frame, as 0xRRGGBB (expanded if the frames are RGB565).
+     */
+    unsigned int getPreviousPixel(int x, int y) const;
+
     /**
      * @brief Flushes the window buffer to the screen.
      */
@@ -82,11 +155,24 @@ public:
      */
     void updateFPS(double fps);
 
+    /**
+     * @brief Parses the name of a framebuffer format ("rgb888" or "rgb565").
+     * @param name The name of the format.
+     * @return The corresponding format.
+     */
+    static FramebufferFormat parseFramebufferFormat(const std::string &name);
+
 private:
     int width, height; // The width and height of the window.
 
-    int *imgBuffer; // The buffer for the window image.
-    XImage *img;    // The X11 image for the window.
+    bool headless;                   // Whether the window manager renders without a window.
+    FramebufferFormat format;        // The format of the pixels of the frames.
+    int *imgBuffer;                  // The buffer for the window image (with RGB565 frames, the 32-bit conversion of the frame, NULL if not needed).
+    int *prevBuffer;                 // The buffer of the previous frame (NULL unless the previous frame is kept).
+    unsigned short *imgBuffer16;     // The buffer of the RGB565 frame being drawn (NULL with RGB888 frames).
+    unsigned short *prevBuffer16;    // The buffer of the previous RGB565 frame (NULL unless the previous frame is kept).
+    std::vector<unsigned int> to888; // The 0xRRGGBB color of every RGB565 color (empty with RGB888 frames).
+    XImage *img;                     // The X11 image for the window.
 
     int screen;       // The screen number of the window.
     Display *display; // The display of the window.
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 /**
  * @brief Converts the given RGB values to a single unsigned integer.
@@ -21,19 +22,42 @@ struct NetworkData
 {
     int listeningPort;                                // The port on which the server listens for incoming connections.
     std::vector<std::pair<std::string, int>> ipPorts; // The list of IP addresses and ports.
+    std::vector<int> ids;                             // The ids of the players in the packets, by index of ipPorts.
 };
 
 /**
  * @brief Parses the IP addresses and ports from the specified file.
  * The file should contain the listening port on the first line, followed by the IP addresses and ports on subsequent lines.
+ * A port may be followed by the id of the player in the packets (see --player-id), which is the port otherwise.
  * Example:
  * 12345
  * 127.0.0.1 12346
- * 127.0.0.1 12347
+ * 127.0.0.1 12347 7
  *
  * @param path The path to the file containing the IP addresses and ports.
  * @return The network data.
  */
 NetworkData parseIPs(std::string path);
 
+/**
+ * @brief Checks if an IP address is on the loopback interface, i.e. the player behind it runs on this host.
+ *
+ * @param ip The IP address.
+ * @return true if the address is in 127.0.0.0/8.
+ */
+bool isLoopbackAddress(const std::string &ip);
+
+/**
+ * @brief Parses the optional command line arguments, given in the form --name=value.
+ * Example: --walls=segments
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param first The index of the first optional argument.
+ * @param names The names of the options accepted by the program.
+ * @return The values of the options, indexed by their name.
+ * @throws std::invalid_argument If an argument is not an option or names an unknown option.
+ */
+std::map<std::string, std::string> parseOptions(int argc, char *argv[], int first, const std::vector<std::string> &names);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <AssetPack.h>
+
+std::shared_ptr<AssetPack> AssetPack::open(const std::string &path)
+{
+    return std::shared_ptr<AssetPack>(new AssetPack(path));
+}
+
+AssetPack::AssetPack(const std::string &path) : data(NULL), size(0), entries(NULL), count(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open asset pack: " + path);
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < off_t(sizeof(Header)))
+    {
+        close(fd);
+        throw std::runtime_error("Invalid asset pack: " + path);
+    }
+    size = info.st_size;
+    // the mapping stays valid once the file is closed
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Failed to map asset pack: " + path);
+    data = (const unsigned char *)mapping;
+
+    // the header, the table and the pixels of every entry must be inside the file
+    const Header *header = (const Header *)data;
+    bool valid = memcmp(header->magic, "RCPK", 4) == 0 && header->version == version &&
+                 header->count <= (size - sizeof(Header)) / sizeof(Entry);
+    if (valid)
+    {
+        count = header->count;
+        entries = (const Entry *)(data + sizeof(Header));
+    }
+    for (uint32_t i = 0; valid && i < count; i++)
+    {
+        const Entry &entry = entries[i];
+        bool powersOf2 = entry.width > 0 && (entry.width & (entry.width - 1)) == 0 &&
+                         entry.height > 0 && (entry.height & (entry.height - 1)) == 0;
+        valid = memchr(entry.name, 0, sizeof(entry.name)) && powersOf2 && entry.layout <= uint32_t(TextureLayout::MORTON) &&
+                entry.shades == uint32_t(Texture::storedShades) &&
+                entry.size == uint64_t(entry.width) * entry.height * entry.shades * sizeof(unsigned int) &&
+                entry.offset % alignment == 0 && entry.offset <= size && entry.size <= size - entry.offset;
+    }
+    if (!valid)
+    {
+        munmap(mapping, size);
+        throw std::runtime_error("Invalid asset pack: " + path);
+    }
+}
+
+AssetPack::~AssetPack()
+{
+    munmap((void *)data, size);
+}
+
+void AssetPack::write(const std::string &path, const std::vector<std::pair<std::string, const Texture *>> &textures)
+{
+    Header header = {{'R', 'C', 'P', 'K'}, version, uint32_t(textures.size()), 0};
+    std::vector<Entry> table(textures.size());
+
+    // the pixels follow the table, every texture starting on a cache line
+    uint64_t offset = sizeof(Header) + table.size() * sizeof(Entry);
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        const std::string &name = textures[i].first;
+        const Texture &texture = *textures[i].second;
+        if (name.size() >= sizeof(table[i].name))
+            throw std::invalid_argument("Texture name too long: " + name);
+        if (texture.isIndexed())
+            throw std::invalid_argument("Indexed textures cannot be packed: " + name);
+
+        memset(&table[i], 0, sizeof(Entry));
+        memcpy(table[i].name, name.c_str(), name.size());
+        table[i].width = texture.getWidth();
+        table[i].height = texture.getHeight();
+        table[i].layout = uint32_t(texture.getLayout());
+        table[i].shades = Texture::storedShades;
+        offset = (offset + alignment - 1) / alignment * alignment;
+        table[i].offset = offset;
+        table[i].size = uint64_t(texture.getWidth()) * texture.getHeight() * Texture::storedShades * sizeof(unsigned int);
+        offset += table[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to create asset pack: " + path);
+    file.write((const char *)&header, sizeof(Header));
+    file.write((const char *)table.data(), table.size() * sizeof(Entry));
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        static const char zeros[alignment] = {0};
+        file.write(zeros, table[i].offset - file.tellp());
+        file.write((const char *)textures[i].second->getTexels(), table[i].size);
+    }
+    if (!file)
+        throw std::runtime_error("Failed to write asset pack: " + path);
+}
+
+bool AssetPack::has(const std::string &name) const
+{
+    return find(name) != NULL;
+}
+
+Texture AssetPack::getTexture(const std::string &name) const
+{
+    const Entry *entry = find(name);
+    if (!entry)
+        throw std::invalid_argument("Texture not found in the asset pack: " + name);
+    return Texture(entry->width, entry->height, TextureLayout(entry->layout),
+                   (const unsigned int *)(data + entry->offset), shared_from_this());
+}
+
+size_t AssetPack::getSize() const { return size; }
+
+const AssetPack::Entry *AssetPack::find(const std::string &name) const
+{
+    for (uint32_t i = 0; i < count; i++)
+        if (name == entries[i].name)
+            return &entries[i];
+    return NULL;
+}
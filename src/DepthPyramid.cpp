@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <limits>
+
+#include <DepthPyramid.h>
+
+DepthPyramid::DepthPyramid(int width)
+{
+    int total = 0;
+    for (int size = width; size > 0; size = size > 1 ? (size + 1) / 2 : 0)
+    {
+        offsets.push_back(total);
+        sizes.push_back(size);
+        total += size;
+    }
+    minDepths.resize(total);
+    maxDepths.resize(total);
+}
+
+void DepthPyramid::build(const std::vector<double> &zBuffer)
+{
+    std::copy(zBuffer.begin(), zBuffer.begin() + sizes[0], minDepths.begin());
+    std::copy(zBuffer.begin(), zBuffer.begin() + sizes[0], maxDepths.begin());
+
+    for (size_t level = 1; level < sizes.size(); level++)
+    {
+        const double *childMin = &minDepths[offsets[level - 1]], *childMax = &maxDepths[offsets[level - 1]];
+        double *parentMin = &minDepths[offsets[level]], *parentMax = &maxDepths[offsets[level]];
+        int childSize = sizes[level - 1];
+        for (int i = 0; i < sizes[level]; i++)
+        {
+            // the last entry of a level of odd size only has one child
+            int right = std::min(2 * i + 1, childSize - 1);
+            parentMin[i] = std::min(childMin[2 * i], childMin[right]);
+            parentMax[i] = std::max(childMax[2 * i], childMax[right]);
+        }
+    }
+}
+
+void DepthPyramid::range(int start, int end, double &minDepth, double &maxDepth) const
+{
+    minDepth = std::numeric_limits<double>::infinity();
+    maxDepth = -std::numeric_limits<double>::infinity();
+
+    // Climb the levels: the entries at the odd ends of the range are not fully covered by an entry of the next
+    // level, they are taken at this level before moving up.
+    for (size_t level = 0; start < end; level++)
+    {
+        const double *levelMin = &minDepths[offsets[level]], *levelMax = &maxDepths[offsets[level]];
+        if (start & 1)
+        {
+            minDepth = std::min(minDepth, levelMin[start]);
+            maxDepth = std::max(maxDepth, levelMax[start]);
+            start++;
+        }
+        if (end & 1)
+        {
+            end--;
+            minDepth = std::min(minDepth, levelMin[end]);
+            maxDepth = std::max(maxDepth, levelMax[end]);
+        }
+        start >>= 1;
+        end >>= 1;
+    }
+}
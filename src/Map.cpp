@@ -2,28 +2,122 @@
 #include <util.h>
 #include <textures.h>
 
+// The floor and ceiling are walked along the rows of the screen, which cross their textures in every direction as the
+// player turns. The Z-order keeps these walks local, which pays once a shade level of the texture does not fit in the
+// L1 cache; below that, the row-major order is cheaper to address.
+static TextureLayout surfaceLayout(int width, int height)
+{
+    return width * height * sizeof(unsigned int) > 16 * 1024 ? TextureLayout::MORTON : TextureLayout::ROW_MAJOR;
+}
+
 Map::Map(
     int width, int height,
     const Texture &floorTexture,
     const Texture &ceilingTexture,
     std::initializer_list<Texture> textures,
-    std::vector<Sprite> &sprites)
+    std::initializer_list<Texture> spriteTextures,
+    const std::vector<Sprite> &sprites,
+    int spriteCapacity)
     : width(width),
       height(height),
       map(width * height),
-      sprites(sprites),
+      sprites(spriteCapacity),
+      spriteGrid(width, height, spriteCellSize, spriteCapacity),
+      spriteTextures(spriteTextures),
+      nbWallTextures(textures.size()),
       floorTexture(floorTexture),
-      ceilingTexture(ceilingTexture)
+      ceilingTexture(ceilingTexture),
+      textureCache(NULL)
 {
     this->textures.reserve(textures.size());
     for (const Texture &texture : textures)
         this->textures.push_back(texture);
+    this->spriteSpans.reserve(this->spriteTextures.size());
+    for (const Texture &texture : this->spriteTextures)
+        this->spriteSpans.push_back(OpaqueSpans(texture));
+    for (const Sprite &sprite : sprites)
+        addSprite(sprite.posX(), sprite.posY(), sprite.getTextureId());
 }
 
 int Map::get(int x, int y) const { return map[x + y * width]; }
+int Map::getWidth() const { return width; }
+int Map::getHeight() const { return height; }
 const Texture &Map::getFloorTexture() const { return floorTexture; }
 const Texture &Map::getCeilingTexture() const { return ceilingTexture; }
-const std::vector<Sprite> &Map::getSprites() const { return sprites; }
+const SpritePool &Map::getSprites() const { return sprites; }
+const Texture &Map::getSpriteTexture(int textureId) const { return spriteTextures[textureId]; }
+const OpaqueSpans &Map::getSpriteSpans(int textureId) const { return spriteSpans[textureId]; }
+const SpriteGrid &Map::getSpriteGrid() const { return spriteGrid; }
+
+int Map::addSprite(double x, double y, int textureId)
+{
+    int id = sprites.add(x, y, textureId, 0);
+    spriteGrid.insert(id, x, y);
+    return id;
+}
+
+void Map::removeSprite(int id)
+{
+    spriteGrid.remove(id);
+    sprites.remove(id);
+}
+
+void Map::moveSprite(int id, double x, double y)
+{
+    sprites.move(id, x, y);
+    spriteGrid.move(id, x, y);
+}
+
+void Map::setTextureLayouts(TextureLayout walls, TextureLayout floorCeiling, TextureLayout sprites)
+{
+    for (Texture &texture : textures)
+        texture.setLayout(walls);
+    if (textureCache)
+        textureCache->convert([walls](Texture &texture)
+                              { texture.setLayout(walls); });
+    floorTexture.setLayout(floorCeiling);
+    ceilingTexture.setLayout(floorCeiling);
+    for (Texture &texture : spriteTextures)
+        texture.setLayout(sprites);
+}
+
+void Map::palettizeTextures()
+{
+    for (Texture &texture : textures)
+        texture.palettize();
+    if (textureCache)
+        textureCache->convert([](Texture &texture)
+                              { texture.palettize(); });
+    for (Texture &texture : spriteTextures)
+        texture.palettize();
+    floorTexture.palettize();
+    ceilingTexture.palettize();
+}
+
+void Map::prepareTexturesRGB565()
+{
+    for (Texture &texture : textures)
+        texture.prepareRGB565();
+    if (textureCache)
+        textureCache->convert([](Texture &texture)
+                              { texture.prepareRGB565(); });
+    for (Texture &texture : spriteTextures)
+        texture.prepareRGB565();
+    floorTexture.prepareRGB565();
+    ceilingTexture.prepareRGB565();
+}
+
+size_t Map::getTexturesMemorySize() const
+{
+    size_t size = floorTexture.getMemorySize() + ceilingTexture.getMemorySize();
+    for (const Texture &texture : textures)
+        size += texture.getMemorySize();
+    for (const Texture &texture : spriteTextures)
+        size += texture.getMemorySize();
+    if (textureCache)
+        size += textureCache->getStats().residentBytes;
+    return size;
+}
 
 bool Map::hasWall(int x, int y) const
 {
@@ -34,10 +128,51 @@ bool Map::hasWall(int x, int y) const
 
 const Texture &Map::getTexture(int x, int y) const
 {
-    return textures[map[x + y * width] - 1];
+    int index = map[x + y * width] - 1;
+    return textureCache ? textureCache->get(index) : textures[index];
+}
+
+// The names of the textures of the map in an asset pack, by usage.
+static std::string wallTextureName(int index) { return "wall" + std::to_string(index); }
+static std::string spriteTextureName(int index) { return "sprite" + std::to_string(index); }
+
+void Map::writeAssetPack(const std::string &path) const
+{
+    std::vector<std::pair<std::string, const Texture *>> packed = {{"floor", &floorTexture}, {"ceiling", &ceilingTexture}};
+    // the walls get low-resolution placeholders, used by a texture cache while they load
+    std::vector<Texture> placeholders;
+    for (const Texture &texture : textures)
+        placeholders.push_back(texture.downsampled(TextureCache::placeholderSize, TextureCache::placeholderSize));
+    for (int i = 0; i < int(textures.size()); i++)
+    {
+        packed.push_back({wallTextureName(i), &textures[i]});
+        packed.push_back({TextureCache::placeholderName(wallTextureName(i)), &placeholders[i]});
+    }
+    for (int i = 0; i < int(spriteTextures.size()); i++)
+        packed.push_back({spriteTextureName(i), &spriteTextures[i]});
+    AssetPack::write(path, packed);
+}
+
+std::vector<std::string> Map::getWallTextureNames() const
+{
+    std::vector<std::string> names;
+    for (int i = 0; i < nbWallTextures; i++)
+        names.push_back(wallTextureName(i));
+    return names;
+}
+
+void Map::setTextureCache(TextureCache *cache)
+{
+    textureCache = cache;
+    std::vector<Texture>().swap(textures);
 }
 
 Map Map::generateMap(int nbPlayers)
+{
+    return generateMap(nbPlayers, NULL);
+}
+
+Map Map::generateMap(int nbPlayers, const AssetPack *pack)
 {
     int width = 24, height = 24;
 
@@ -68,9 +203,8 @@ Map Map::generateMap(int nbPlayers)
             {2, 2, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0, 2, 2, 0, 5, 0, 5, 0, 0, 0, 5, 5},
             {2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 5, 5, 5, 5, 5, 5, 5, 5, 5}};
 
-    Texture greenLight(64, 64, textures::greenlight, true);
-    Texture pillar(64, 64, textures::pillar, true);
-    Texture barrel(64, 64, textures::barrel, true);
+    // indexes of the sprite textures
+    const int greenLight = 0, pillar = 1, barrel = 2;
 
     std::vector<Sprite> sprites;
     for (int i = 0; i < nbPlayers; i++)
@@ -102,20 +236,36 @@ Map Map::generateMap(int nbPlayers)
             Sprite({10.5, 15.8}, barrel),
         });
 
+    // the textures of a pack are stored as the built-in ones are converted here
+    auto texture = [&](const std::string &name, const unsigned int *pixels, TextureLayout layout)
+    { return pack ? pack->getTexture(name) : Texture(64, 64, pixels, layout); };
+
+    // the walls and sprites are drawn column by column, hence the column-major textures
+    const TextureLayout column = TextureLayout::COLUMN_MAJOR;
     Map map(
         width, height,
-        Texture(64, 64, textures::greystone, false),
-        Texture(64, 64, textures::wood, false),
+        texture("floor", textures::greystone, surfaceLayout(64, 64)),
+        texture("ceiling", textures::wood, surfaceLayout(64, 64)),
+        {
+            texture(wallTextureName(0), textures::eagle, column),
+            texture(wallTextureName(1), textures::redbrick, column),
+            texture(wallTextureName(2), textures::purplestone, column),
+            texture(wallTextureName(3), textures::greystone, column),
+            texture(wallTextureName(4), textures::bluestone, column),
+            texture(wallTextureName(5), textures::mossy, column),
+            texture(wallTextureName(6), textures::wood, column),
+            texture(wallTextureName(7), textures::colorstone, column),
+        },
         {
-            Texture(64, 64, textures::eagle, true),
-            Texture(64, 64, textures::redbrick, true),
-            Texture(64, 64, textures::purplestone, true),
-            Texture(64, 64, textures::greystone, true),
-            Texture(64, 64, textures::bluestone, true),
-            Texture(64, 64, textures::mossy, true),
-            Texture(64, 64, textures::wood, true),
-            Texture(64, 64, textures::colorstone, true),
-        }, sprites);
+            texture(spriteTextureName(greenLight), textures::greenlight, column),
+            texture(spriteTextureName(pillar), textures::pillar, column),
+            texture(spriteTextureName(barrel), textures::barrel, column),
+        },
+        sprites, maxSprites);
+
+    // the players are hidden until their position is received
+    for (int i = 0; i < nbPlayers; i++)
+        map.sprites.setFlags(i, SpritePool::HIDDEN);
 
     for (int x = 0; x < width; x++)
         for (int y = 0; y < height; y++)
@@ -126,5 +276,6 @@ Map Map::generateMap(int nbPlayers)
 
 void Map::movePlayer(int index, double x, double y)
 {
-    sprites[index].move(x, y);
+    moveSprite(index, x, y);
+    sprites.setFlags(index, 0);
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include <OpaqueSpans.h>
+
+OpaqueSpans::OpaqueSpans(const Texture &texture) : offsets(texture.getWidth() + 1)
+{
+    for (int x = 0; x < texture.getWidth(); x++)
+    {
+        offsets[x] = spans.size();
+        int start = -1;
+        for (int y = 0; y <= texture.getHeight(); y++)
+        {
+            bool opaque = y < texture.getHeight() && (texture.get(x, y) & 0x00FFFFFF) != 0;
+            if (opaque && start < 0)
+                start = y;
+            else if (!opaque && start >= 0)
+            {
+                spans.push_back({start, y});
+                start = -1;
+            }
+        }
+    }
+    offsets[texture.getWidth()] = spans.size();
+}
+
+const OpaqueSpan *OpaqueSpans::get(int x) const { return spans.data() + offsets[x]; }
+int OpaqueSpans::count(int x) const { return offsets[x + 1] - offsets[x]; }
@@ -0,0 +1,63 @@
+#include <PeerTable.h>
+
+std::ostream &operator<<(std::ostream &os, const PeerStats &stats)
+{
+    os << "Position packets: " << stats.accepted << " accepted, " << stats.stale << " stale, " << stats.malformed
+       << " malformed, from " << stats.peers << " players (" << stats.restarts << " restarts)" << std::endl;
+    return os;
+}
+
+PeerTable::PeerTable(int players, int localId)
+    : players(players),
+      localId(localId),
+      nextIndex(0),
+      indexes(maxIds, -1),
+      sequences(maxIds, 0),
+      timestamps(maxIds, 0),
+      heard(maxIds, false)
+{
+}
+
+bool PeerTable::accept(const unsigned char *data, int length, PositionPacket &packet)
+{
+    if (!packet.decode(data, length))
+    {
+        stats.malformed++;
+        return false;
+    }
+
+    // the difference of the sequence numbers, taken as signed, orders them across the wrap-around
+    int sender = packet.getSender();
+    if (heard[sender] && int32_t(packet.getSequence() - sequences[sender]) <= 0)
+    {
+        // A packet reordered or duplicated is close behind the last one and was sent before it, while a sender that
+        // restarted is either far behind or sent its packet later (its clock is monotonic).
+        if (int32_t(packet.getSequence() - sequences[sender]) >= -restartWindow &&
+            int32_t(packet.getTimestamp() - timestamps[sender]) <= 0)
+        {
+            stats.stale++;
+            return false;
+        }
+        stats.restarts++;
+    }
+    heard[sender] = true;
+    sequences[sender] = packet.getSequence();
+    timestamps[sender] = packet.getTimestamp();
+    stats.accepted++;
+    return true;
+}
+
+int PeerTable::getIndex(int id)
+{
+    if (id == localId || players == 0)
+        return -1;
+    if (indexes[id] < 0)
+    {
+        indexes[id] = nextIndex;
+        nextIndex = (nextIndex + 1) % players;
+        stats.peers++;
+    }
+    return indexes[id];
+}
+
+const PeerStats &PeerTable::getStats() const { return stats; }
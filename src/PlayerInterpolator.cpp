@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include <PlayerInterpolator.h>
+
+PlayerInterpolator::PlayerInterpolator(int players, int delay) : delay(delay), histories(players)
+{
+}
+
+const PlayerInterpolator::Sample &PlayerInterpolator::History::back(int age) const
+{
+    return samples[(next - 1 - age + historySize) % historySize];
+}
+
+void PlayerInterpolator::update(const std::vector<PlayerState> &states)
+{
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        const PlayerState &state = states[i];
+        History &history = histories[i];
+        // the timestamps are compared through their signed difference, to order them across the wrap-around
+        if (!state.received || (history.count > 0 && int32_t(state.timestamp - history.back(0).timestamp) <= 0))
+            continue;
+
+        Sample &sample = history.samples[history.next];
+        sample.x = state.x;
+        sample.y = state.y;
+        sample.timestamp = state.timestamp;
+        sample.offset = state.arrival - state.timestamp;
+        history.next = (history.next + 1) % historySize;
+        history.count = std::min(history.count + 1, historySize);
+
+        // the fastest state of the history bounds the offset best: the others were delayed on the way
+        history.offset = sample.offset;
+        for (int age = 1; age < history.count; age++)
+            if (int32_t(history.back(age).offset - history.offset) < 0)
+                history.offset = history.back(age).offset;
+    }
+}
+
+bool PlayerInterpolator::getPosition(int index, uint32_t now, double &x, double &y) const
+{
+    const History &history = histories[index];
+    if (history.count == 0)
+        return false;
+
+    const Sample &newest = history.back(0);
+    uint32_t target = now - delay - history.offset;
+    int32_t ahead = target - newest.timestamp;
+    if (delay == 0 || ahead >= 0)
+    {
+        // past the newest state, the motion between the last two states continues for a short while
+        x = newest.x;
+        y = newest.y;
+        if (delay > 0 && history.count > 1)
+        {
+            const Sample &previous = history.back(1);
+            double t = double(std::min(ahead, int32_t(maxExtrapolation))) / int32_t(newest.timestamp - previous.timestamp);
+            x += (newest.x - previous.x) * t;
+            y += (newest.y - previous.y) * t;
+        }
+        return true;
+    }
+
+    // the first state sent before the target and the next one surround it
+    for (int age = 1; age < history.count; age++)
+    {
+        const Sample &before = history.back(age), &after = history.back(age - 1);
+        int32_t elapsed = target - before.timestamp;
+        if (elapsed >= 0)
+        {
+            double t = double(elapsed) / int32_t(after.timestamp - before.timestamp);
+            x = before.x + (after.x - before.x) * t;
+            y = before.y + (after.y - before.y) * t;
+            return true;
+        }
+    }
+
+    // the target is older than the whole history
+    x = history.back(history.count - 1).x;
+    y = history.back(history.count - 1).y;
+    return true;
+}
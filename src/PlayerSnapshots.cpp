@@ -0,0 +1,31 @@
+#include <PlayerSnapshots.h>
+
+PlayerSnapshots::PlayerSnapshots(int players)
+    : states(players),
+      back(0),
+      middle(1),
+      front(2)
+{
+    for (std::vector<PlayerState> &buffer : buffers)
+        buffer.resize(players);
+}
+
+void PlayerSnapshots::set(int index, const PlayerState &state) { states[index] = state; }
+
+void PlayerSnapshots::publish()
+{
+    // the release makes the copy visible to the renderer once it takes the buffer
+    buffers[back] = states;
+    back = middle.exchange(back | published, std::memory_order_acq_rel) & ~published;
+}
+
+bool PlayerSnapshots::acquire()
+{
+    if (!(middle.load(std::memory_order_relaxed) & published))
+        return false;
+    // the acquire makes the copy of the network thread visible
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~published;
+    return true;
+}
+
+const std::vector<PlayerState> &PlayerSnapshots::getSnapshot() const { return buffers[front]; }
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cmath>
+
+#include <PositionPacket.h>
+
+static const double fixedPointScale = 65536;         // The positions are sent in 16.16 fixed point.
+static const double angleScale = 65536 / (2 * M_PI); // The directions are sent in 1/65536 of a turn.
+
+static void put16(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    put16(p, v >> 16);
+    put16(p + 2, v);
+}
+
+static uint32_t get16(const unsigned char *p) { return uint32_t(p[0]) << 8 | p[1]; }
+static uint32_t get32(const unsigned char *p) { return get16(p) << 16 | get16(p + 2); }
+
+static uint32_t quantizePosition(double v) { return uint32_t(int32_t(std::lround(v * fixedPointScale))); }
+static double dequantizePosition(uint32_t v) { return int32_t(v) / fixedPointScale; }
+static uint32_t quantizeAngle(double v) { return uint32_t(std::lround(v * angleScale)) & 0xFFFF; }
+static double dequantizeAngle(uint32_t v) { return v / angleScale; }
+
+PositionPacket::PositionPacket() : PositionPacket(0, 0, 0)
+{
+}
+
+PositionPacket::PositionPacket(int sender, uint32_t sequence, uint32_t timestamp)
+    : sender(sender), sequence(sequence), timestamp(timestamp), count(0)
+{
+}
+
+bool PositionPacket::add(const EntityUpdate &update)
+{
+    if (count == maxUpdates)
+        return false;
+    // the update is stored as the receivers will decode it
+    EntityUpdate &quantized = updates[count++];
+    quantized.id = update.id & 0xFFFF;
+    quantized.x = dequantizePosition(quantizePosition(update.x));
+    quantized.y = dequantizePosition(quantizePosition(update.y));
+    quantized.direction = dequantizeAngle(quantizeAngle(update.direction));
+    return true;
+}
+
+int PositionPacket::encode(unsigned char *buffer) const
+{
+    encodeHeader(buffer, sequence);
+    unsigned char *p = buffer + headerSize;
+    for (int i = 0; i < count; i++, p += updateSize)
+    {
+        put16(p, updates[i].id);
+        put16(p + 2, quantizeAngle(updates[i].direction));
+        put32(p + 4, quantizePosition(updates[i].x));
+        put32(p + 8, quantizePosition(updates[i].y));
+    }
+    return getSize();
+}
+
+void PositionPacket::encodeHeader(unsigned char *buffer, uint32_t sequence) const
+{
+    buffer[0] = version;
+    buffer[1] = count;
+    put16(buffer + 2, sender);
+    put32(buffer + 4, sequence);
+    put32(buffer + 8, timestamp);
+}
+
+bool PositionPacket::decode(const unsigned char *data, int length)
+{
+    if (length < headerSize || data[0] != version || data[1] > maxUpdates || length != headerSize + data[1] * updateSize)
+        return false;
+    count = data[1];
+    sender = get16(data + 2);
+    sequence = get32(data + 4);
+    timestamp = get32(data + 8);
+    const unsigned char *p = data + headerSize;
+    for (int i = 0; i < count; i++, p += updateSize)
+    {
+        updates[i].id = get16(p);
+        updates[i].direction = dequantizeAngle(get16(p + 2));
+        updates[i].x = dequantizePosition(get32(p + 4));
+        updates[i].y = dequantizePosition(get32(p + 8));
+    }
+    return true;
+}
+
+int PositionPacket::getSender() const { return sender; }
+uint32_t PositionPacket::getSequence() const { return sequence; }
+uint32_t PositionPacket::getTimestamp() const { return timestamp; }
+int PositionPacket::getCount() const { return count; }
+const EntityUpdate &PositionPacket::getUpdate(int i) const { return updates[i]; }
+int PositionPacket::getSize() const { return headerSize + count * updateSize; }
+
+uint32_t PositionPacket::now()
+{
+    auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
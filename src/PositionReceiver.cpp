@@ -0,0 +1,71 @@
+#include <algorithm>
+
+#include <PositionReceiver.h>
+
+PositionReceiver::PositionReceiver(PeerTable &peers, PlayerSnapshots &snapshots, bool measure)
+    : peers(peers),
+      snapshots(snapshots),
+      measure(measure),
+      lastSequences(measure ? PeerTable::maxIds : 0),
+      seen(measure ? PeerTable::maxIds : 0, false),
+      packets(0),
+      updates(0),
+      lost(0),
+      latencies(maxLatency + 1)
+{
+    for (std::atomic<long> &count : latencies)
+        count = 0;
+}
+
+bool PositionReceiver::handle(const ReceivedPacket &received, uint32_t arrival)
+{
+    if (!peers.accept(received.data, received.length, packet))
+        return false;
+    // the counters have a single writer: they are only read by the other threads, without a lock
+    if (measure)
+    {
+        // the packets accepted are newer than the previous one of their sender, unless it restarted: a gap in the
+        // sequence was lost
+        int sender = packet.getSender();
+        if (seen[sender] && int32_t(packet.getSequence() - lastSequences[sender]) > 0)
+            lost.fetch_add(packet.getSequence() - lastSequences[sender] - 1, std::memory_order_relaxed);
+        seen[sender] = true;
+        lastSequences[sender] = packet.getSequence();
+        int latency = std::max(int32_t(arrival - packet.getTimestamp()), 0);
+        latencies[std::min(latency, int(maxLatency))].fetch_add(1, std::memory_order_relaxed);
+        packets.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int set = 0;
+    for (int j = 0; j < packet.getCount(); j++)
+    {
+        const EntityUpdate &update = packet.getUpdate(j);
+        int index = peers.getIndex(update.id);
+        if (index < 0)
+            continue;
+        PlayerState state;
+        state.id = update.id;
+        state.x = update.x;
+        state.y = update.y;
+        state.direction = update.direction;
+        state.timestamp = packet.getTimestamp();
+        state.arrival = arrival;
+        state.received = true;
+        snapshots.set(index, state);
+        set++;
+    }
+    if (measure)
+        updates.fetch_add(set, std::memory_order_relaxed);
+    return set > 0;
+}
+
+PositionReceiveStats PositionReceiver::getStats() const
+{
+    PositionReceiveStats stats;
+    stats.packets = packets.load(std::memory_order_relaxed);
+    stats.updates = updates.load(std::memory_order_relaxed);
+    stats.lost = lost.load(std::memory_order_relaxed);
+    for (const std::atomic<long> &count : latencies)
+        stats.latencies.push_back(count.load(std::memory_order_relaxed));
+    return stats;
+}
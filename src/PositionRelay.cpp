@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <PositionRelay.h>
+
+std::ostream &operator<<(std::ostream &os, const RelayStats &stats)
+{
+    double seconds = std::max(stats.seconds, 1e-3);
+    os << "Relay: " << stats.received / seconds << " packets/s received (" << stats.updates / seconds
+       << " updates/s), " << stats.sent / seconds << " packets/s sent in " << stats.ticks / seconds
+       << " snapshots/s, instead of " << stats.meshPackets / seconds << " packets/s between the players" << std::endl;
+    if (stats.unfiltered > 0)
+        os << "Relay: " << stats.forwarded / seconds << " updates/s forwarded, " << 100.0 * stats.forwarded / stats.unfiltered
+           << "% of the updates without interest management" << std::endl;
+    return os;
+}
+
+PositionRelay::PositionRelay(int port, const std::vector<std::pair<std::string, int>> &subscribers, int id, int tick)
+    : receiver(port, 1024),
+      sender(subscribers),
+      peers(0, -1),
+      id(id),
+      tick(tick),
+      sequences(subscribers.size(), 0),
+      everyone(subscribers.size()),
+      nextTick(PositionPacket::now() + tick),
+      start(PositionPacket::now()),
+      latest(PeerTable::maxIds),
+      updated(PeerTable::maxIds, false),
+      known(PeerTable::maxIds, false),
+      pvs(NULL),
+      backgroundInterval(0),
+      nextBackground(0)
+{
+    for (size_t i = 0; i < subscribers.size(); i++)
+        everyone[i] = i;
+}
+
+void PositionRelay::setInterestManagement(const PotentiallyVisibleSet *pvs, const std::vector<int> &ids, int backgroundInterval)
+{
+    if (pvs && int(ids.size()) != sender.getDestinationCount())
+        throw std::invalid_argument("The ids do not match the subscribers");
+    this->pvs = pvs;
+    subscriberIds = ids;
+    subscriberCells.assign(ids.size(), -1);
+    this->backgroundInterval = backgroundInterval;
+    nextBackground = PositionPacket::now() + backgroundInterval;
+}
+
+void PositionRelay::update()
+{
+    int wait = std::max(int32_t(nextTick - PositionPacket::now()), 0);
+    int count = receiver.receive(wait);
+    for (int i = 0; i < count; i++)
+    {
+        const ReceivedPacket &received = receiver.getPacket(i);
+        if (!peers.accept(received.data, received.length, packet))
+            continue;
+        stats.received++;
+        // without the relay, the packet would have been sent to all the other players
+        stats.meshPackets += std::max(sender.getDestinationCount() - 1, 0);
+        for (int j = 0; j < packet.getCount(); j++)
+        {
+            const EntityUpdate &update = packet.getUpdate(j);
+            latest[update.id] = update;
+            if (!updated[update.id])
+            {
+                updated[update.id] = true;
+                updatedIds.push_back(update.id);
+            }
+            if (!known[update.id])
+            {
+                known[update.id] = true;
+                knownIds.push_back(update.id);
+            }
+            stats.updates++;
+        }
+    }
+
+    uint32_t now = PositionPacket::now();
+    if (int32_t(now - nextTick) < 0)
+        return;
+    sendSnapshot();
+    // a late tick does not make the next ones closer together
+    nextTick += tick;
+    if (int32_t(now - nextTick) >= 0)
+        nextTick = now + tick;
+}
+
+void PositionRelay::sendSnapshot()
+{
+    int subscribers = sender.getDestinationCount();
+    long sent = stats.sent;
+    if (pvs)
+        stats.unfiltered += long(updatedIds.size()) * subscribers;
+    uint32_t now = PositionPacket::now();
+    if (pvs && int32_t(now - nextBackground) >= 0)
+    {
+        // the background snapshot corrects the positions of the players who were out of sight
+        sendUpdates(knownIds, NULL, -1);
+        nextBackground = now + backgroundInterval;
+    }
+    else if (pvs)
+    {
+        groups.clear();
+        for (int i = 0; i < subscribers; i++)
+        {
+            const EntityUpdate &position = latest[subscriberIds[i]];
+            int cell = known[subscriberIds[i]] ? pvs->getCell(position.x, position.y) : -1;
+            // a subscriber entering a cell gets the players it can see from there, which it may not know about
+            if (cell >= 0 && cell != subscriberCells[i])
+            {
+                destinations.assign(1, i);
+                sendUpdates(knownIds, &destinations, cell);
+                subscriberCells[i] = cell;
+                continue;
+            }
+            groups.push_back({cell, i});
+        }
+
+        // the subscribers in the same cell get the same packets
+        std::sort(groups.begin(), groups.end());
+        for (size_t first = 0, last; first < groups.size(); first = last)
+        {
+            destinations.clear();
+            for (last = first; last < groups.size() && groups[last].first == groups[first].first; last++)
+                destinations.push_back(groups[last].second);
+            sendUpdates(updatedIds, &destinations, groups[first].first);
+        }
+    }
+    else
+        sendUpdates(updatedIds, NULL, -1);
+    if (stats.sent > sent)
+        stats.ticks++;
+
+    for (int updatedId : updatedIds)
+        updated[updatedId] = false;
+    updatedIds.clear();
+}
+
+void PositionRelay::sendUpdates(const std::vector<int> &ids, const std::vector<int> *indexes, int cell)
+{
+    if (!indexes)
+        indexes = &everyone;
+    int subscribers = indexes->size();
+    // the packets are numbered per subscriber, so that a gap in the sequence of a subscriber is a packet lost even
+    // though the subscribers in different cells are sent different packets
+    auto send = [&]()
+    {
+        if (packet.getCount() == 0)
+            return;
+        sender.send(packet, *indexes, sequences);
+        stats.sent += subscribers;
+        stats.forwarded += long(packet.getCount()) * subscribers;
+    };
+
+    packet = PositionPacket(id, 0, PositionPacket::now());
+    for (int entity : ids)
+    {
+        const EntityUpdate &update = latest[entity];
+        int entityCell = pvs ? pvs->getCell(update.x, update.y) : -1;
+        if (cell >= 0 && entityCell >= 0 && !pvs->isVisible(cell, entityCell))
+            continue;
+        if (!packet.add(update))
+        {
+            send();
+            packet = PositionPacket(id, 0, packet.getTimestamp());
+            packet.add(update);
+        }
+    }
+    send();
+}
+
+int PositionRelay::getPort() const { return receiver.getPort(); }
+
+RelayStats PositionRelay::getStats() const
+{
+    RelayStats current = stats;
+    current.seconds = int32_t(PositionPacket::now() - start) / 1000.0;
+    return current;
+}
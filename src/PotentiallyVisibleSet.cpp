@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <PotentiallyVisibleSet.h>
+
+/**
+ * @brief The header of a potentially visible set file, followed by the rows of the matrix.
+ */
+struct PVSHeader
+{
+    char magic[4];    // "RPVS".
+    uint32_t version; // The version of the format.
+    int32_t width;    // The width of the map, in tiles.
+    int32_t height;   // The height of the map, in tiles.
+    int32_t cellSize; // The width and height of the cells, in tiles.
+};
+
+PotentiallyVisibleSet::PotentiallyVisibleSet(int width, int height, int cellSize)
+    : width(width),
+      height(height),
+      cellSize(cellSize),
+      columns((width + cellSize - 1) / cellSize),
+      rows((height + cellSize - 1) / cellSize),
+      words((columns * rows + 63) / 64),
+      bits(size_t(columns) * rows * words, 0)
+{
+    if (width <= 0 || height <= 0 || cellSize <= 0)
+        throw std::invalid_argument("Invalid potentially visible set size");
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet(const std::vector<bool> &walls, int width, int height, int cellSize)
+    : PotentiallyVisibleSet(width, height, cellSize)
+{
+    if (walls.size() != size_t(width) * height)
+        throw std::invalid_argument("The walls do not match the size of the map");
+    compute(walls);
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet(const Map &map, int cellSize)
+    : PotentiallyVisibleSet(map.getWidth(), map.getHeight(), cellSize)
+{
+    std::vector<bool> walls(size_t(width) * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            walls[x + y * width] = map.hasWall(x, y);
+    compute(walls);
+}
+
+PotentiallyVisibleSet PotentiallyVisibleSet::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open potentially visible set: " + path);
+    PVSHeader header;
+    if (!file.read((char *)&header, sizeof(header)) || memcmp(header.magic, "RPVS", 4) != 0 ||
+        header.version != version || header.width <= 0 || header.height <= 0 || header.cellSize <= 0)
+        throw std::runtime_error("Invalid potentially visible set: " + path);
+
+    PotentiallyVisibleSet pvs(header.width, header.height, header.cellSize);
+    if (!file.read((char *)pvs.bits.data(), pvs.bits.size() * sizeof(uint64_t)) || file.peek() != EOF)
+        throw std::runtime_error("Invalid potentially visible set: " + path);
+    return pvs;
+}
+
+void PotentiallyVisibleSet::save(const std::string &path) const
+{
+    PVSHeader header = {{'R', 'P', 'V', 'S'}, version, width, height, cellSize};
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)bits.data(), bits.size() * sizeof(uint64_t));
+    if (!file)
+        throw std::runtime_error("Failed to write potentially visible set: " + path);
+}
+
+int PotentiallyVisibleSet::getCell(double x, double y) const
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return -1;
+    return int(x) / cellSize + int(y) / cellSize * columns;
+}
+
+bool PotentiallyVisibleSet::isVisible(int from, int to) const
+{
+    return bits[size_t(from) * words + to / 64] >> (to % 64) & 1;
+}
+
+int PotentiallyVisibleSet::getCellCount() const { return columns * rows; }
+
+double PotentiallyVisibleSet::getVisibleFraction() const
+{
+    long visible = 0;
+    for (uint64_t word : bits)
+        visible += __builtin_popcountll(word);
+    return double(visible) / (double(getCellCount()) * getCellCount());
+}
+
+void PotentiallyVisibleSet::setVisible(int from, int to)
+{
+    bits[size_t(from) * words + to / 64] |= uint64_t(1) << (to % 64);
+}
+
+void PotentiallyVisibleSet::compute(const std::vector<bool> &walls)
+{
+    // the center and points near the corners of every tile
+    const double points[5][2] = {{0.5, 0.5}, {0.05, 0.05}, {0.95, 0.05}, {0.05, 0.95}, {0.95, 0.95}};
+    std::vector<double> dirX(raysPerPoint), dirY(raysPerPoint);
+    for (int i = 0; i < raysPerPoint; i++)
+    {
+        dirX[i] = std::cos(2 * M_PI * (i + 0.5) / raysPerPoint);
+        dirY[i] = std::sin(2 * M_PI * (i + 0.5) / raysPerPoint);
+    }
+
+    // every cell only writes its own row
+    int cells = getCellCount();
+#pragma omp parallel for schedule(dynamic)
+    for (int cell = 0; cell < cells; cell++)
+    {
+        int cellX = cell % columns, cellY = cell / columns;
+        for (int tileY = cellY * cellSize; tileY < std::min((cellY + 1) * cellSize, height); tileY++)
+            for (int tileX = cellX * cellSize; tileX < std::min((cellX + 1) * cellSize, width); tileX++)
+            {
+                if (walls[tileX + tileY * width])
+                    continue;
+                setVisible(cell, cell);
+                for (const double *point : points)
+                    for (int ray = 0; ray < raysPerPoint; ray++)
+                    {
+                        // the DDA of the raycaster, through the tiles until a wall or the border of the map
+                        double posX = tileX + point[0], posY = tileY + point[1];
+                        int mapX = tileX, mapY = tileY;
+                        double deltaX = std::abs(1 / dirX[ray]), deltaY = std::abs(1 / dirY[ray]);
+                        int stepX = dirX[ray] < 0 ? -1 : 1, stepY = dirY[ray] < 0 ? -1 : 1;
+                        double sideX = (dirX[ray] < 0 ? posX - mapX : mapX + 1 - posX) * deltaX;
+                        double sideY = (dirY[ray] < 0 ? posY - mapY : mapY + 1 - posY) * deltaY;
+                        for (;;)
+                        {
+                            if (sideX < sideY)
+                            {
+                                sideX += deltaX;
+                                mapX += stepX;
+                            }
+                            else
+                            {
+                                sideY += deltaY;
+                                mapY += stepY;
+                            }
+                            if (mapX < 0 || mapX >= width || mapY < 0 || mapY >= height || walls[mapX + mapY * width])
+                                break;
+                            setVisible(cell, mapX / cellSize + mapY / cellSize * columns);
+                        }
+                    }
+            }
+    }
+
+    // symmetric, grown by one cell on the side seen, then symmetric again to grow both sides
+    auto symmetrize = [&]()
+    {
+        for (int from = 0; from < cells; from++)
+            for (int to = from + 1; to < cells; to++)
+                if (isVisible(from, to) != isVisible(to, from))
+                {
+                    setVisible(from, to);
+                    setVisible(to, from);
+                }
+    };
+    symmetrize();
+    std::vector<uint64_t> seen = bits;
+    for (int from = 0; from < cells; from++)
+        for (int to = 0; to < cells; to++)
+        {
+            if (!(seen[size_t(from) * words + to / 64] >> (to % 64) & 1))
+                continue;
+            int toX = to % columns, toY = to / columns;
+            for (int y = std::max(toY - 1, 0); y <= std::min(toY + 1, rows - 1); y++)
+                for (int x = std::max(toX - 1, 0); x <= std::min(toX + 1, columns - 1); x++)
+                    setVisible(from, x + y * columns);
+        }
+    symmetrize();
+}
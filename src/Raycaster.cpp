@@ -4,8 +4,47 @@
 
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <Raycaster.h>
 
+// Average of two colors, channel by channel (the low bit of every channel is dropped, as when darkening).
+static inline unsigned int averageColor(unsigned int a, unsigned int b)
+{
+    return ((a >> 1) & 8355711) + ((b >> 1) & 8355711);
+}
+
+// Writes a texel to the frame without conversion: its type is the format of the frame.
+static inline void drawTexel(WindowManager &windowManager, int x, int y, unsigned int color)
+{
+    windowManager.drawPixel888(x, y, color);
+}
+
+static inline void drawTexel(WindowManager &windowManager, int x, int y, unsigned short color)
+{
+    windowManager.drawPixel565(x, y, color);
+}
+
+// Row of a sprite texture drawn at the row y of the screen (256 and 128 factors to avoid floats).
+static inline int spriteTexY(int y, int screenHeight, int spriteHeight, int textureHeight)
+{
+    int d = y * 256 - screenHeight * 128 + spriteHeight * 128;
+    return ((d * textureHeight) / spriteHeight) / 256;
+}
+
+// First row of the screen in [yStart, yEnd] showing a texture row at least texY. The mapping is inverted, then the
+// rounding is corrected against spriteTexY so that the rows match the per-pixel mapping exactly.
+static int firstSpriteRow(int texY, int yStart, int yEnd, int screenHeight, int spriteHeight, int textureHeight)
+{
+    int y = texY * spriteHeight / textureHeight + screenHeight / 2 - spriteHeight / 2;
+    y = std::min(std::max(y, yStart), yEnd);
+    while (y > yStart && spriteTexY(y - 1, screenHeight, spriteHeight, textureHeight) >= texY)
+        y--;
+    while (y < yEnd && spriteTexY(y, screenHeight, spriteHeight, textureHeight) < texY)
+        y++;
+    return y;
+}
+
 Raycaster::Raycaster(Player &player, WindowManager &windowManager, Map &map) : player(player),
                                                                                windowManager(windowManager),
                                                                                map(map),
@@ -13,11 +52,38 @@ Raycaster::Raycaster(Player &player, WindowManager &windowManager, Map &map) : p
                                                                                screenHeight(windowManager.getHeight()),
                                                                                floorTexture(map.getFloorTexture()),
                                                                                ceilingTexture(map.getCeilingTexture()),
+                                                                               wallEngine(WallEngine::DDA),
+                                                                               adaptiveStep(8),
+                                                                               wallSegments(map),
+                                                                               wallHits(screenWidth),
+                                                                               nextOpenColumn(screenWidth + 1),
+                                                                               cornerDistances(screenWidth),
+                                                                               columnReprojections(screenWidth),
                                                                                zBuffer(screenWidth),
-                                                                               spriteOrder(map.getSprites().size()),
-                                                                               spriteDistance(map.getSprites().size()),
-                                                                               numSprites(map.getSprites().size())
+                                                                               depthPyramid(screenWidth),
+                                                                               spriteUnoccluded(map.getSprites().capacity()),
+                                                                               spriteOrder(map.getSprites().capacity()),
+                                                                               spriteDistance(map.getSprites().capacity()),
+                                                                               spriteSorter(map.getSprites().capacity()),
+                                                                               numSprites(0),
+                                                                               renderMode(RenderMode::FULL),
+                                                                               frameParity(0),
+                                                                               hasPreviousFrame(false),
+                                                                               prevPosX(0), prevPosY(0),
+                                                                               prevDirX(0), prevDirY(0),
+                                                                               prevCamX(0), prevCamY(0),
+                                                                               fogDistance(0)
 {
+    spriteProjections.resize(map.getSprites().capacity());
+    spriteCandidates.reserve(map.getSprites().capacity());
+
+    // the texels are written to 16-bit frames without conversion
+    if (windowManager.getFormat() == FramebufferFormat::RGB565)
+    {
+        map.prepareTexturesRGB565();
+        floorTexture.prepareRGB565();
+        ceilingTexture.prepareRGB565();
+    }
 }
 
 void Raycaster::castFloorCeiling()
@@ -46,198 +112,529 @@ void Raycaster::castFloorCeiling()
         double floorXBasis = player.posX() + rowDistance * rayDir0.x();
         double floorYBasis = player.posY() + rowDistance * rayDir0.y();
 
-        for (int x = 0; x < screenWidth; ++x)
-        {
-            double floorX = floorXBasis + x * floorStepX;
-            double floorY = floorYBasis + x * floorStepY;
+        // the floor and ceiling are darker than the walls, and the row is at the same distance everywhere
+        int shade = shadeAt(rowDistance, Texture::shadesPerHalving);
+
+        drawFloorRow(y, floorXBasis, floorYBasis, floorStepX, floorStepY, shade);
+    }
+}
+
+void Raycaster::drawFloorRow(int y, double basisX, double basisY, double stepX, double stepY, int shade)
+{
+    // the format and the storage of the textures are chosen once per row, the texels are written without conversion
+    if (windowManager.getFormat() == FramebufferFormat::RGB565)
+        drawFloorRowAs<unsigned short>(y, basisX, basisY, stepX, stepY, shade);
+    else
+        drawFloorRowAs<unsigned int>(y, basisX, basisY, stepX, stepY, shade);
+}
 
-            // the cell coord is simply got from the integer parts of floorX and floorY
-            int cellX = int(floorX);
-            int cellY = int(floorY);
+template <typename Color>
+void Raycaster::drawFloorRowAs(int y, double basisX, double basisY, double stepX, double stepY, int shade)
+{
+    typedef TextureSampler<Color, true> Indexed;
+    typedef TextureSampler<Color, false> Full;
+    if (floorTexture.isIndexed() && ceilingTexture.isIndexed())
+        drawFloorTexels(y, basisX, basisY, stepX, stepY, Indexed(floorTexture, shade), Indexed(ceilingTexture, shade));
+    else if (floorTexture.isIndexed())
+        drawFloorTexels(y, basisX, basisY, stepX, stepY, Indexed(floorTexture, shade), Full(ceilingTexture, shade));
+    else if (ceilingTexture.isIndexed())
+        drawFloorTexels(y, basisX, basisY, stepX, stepY, Full(floorTexture, shade), Indexed(ceilingTexture, shade));
+    else
+        drawFloorTexels(y, basisX, basisY, stepX, stepY, Full(floorTexture, shade), Full(ceilingTexture, shade));
+}
 
-            // get the texture coordinate from the fractional part
-            int tx = int(floorTexture.getWidth() * (floorX - cellX)) & (floorTexture.getWidth() - 1);
-            int ty = int(floorTexture.getHeight() * (floorY - cellY)) & (floorTexture.getHeight() - 1);
+template <typename FloorSampler, typename CeilingSampler>
+void Raycaster::drawFloorTexels(int y, double basisX, double basisY, double stepX, double stepY, FloorSampler floor,
+                                CeilingSampler ceiling)
+{
+    // The floor and ceiling pixels of a column share their texture coordinates. When only one of them is shaded
+    // in this frame (checkerboard mode), every column is visited but only one pixel is shaded per column.
+    int xStep = shadedColumnStep();
+    int ceilingY = screenHeight - y - 1;
+    int floorX0 = firstShadedColumn(y), ceilingX0 = firstShadedColumn(ceilingY);
+    for (int x = std::min(floorX0, ceilingX0); x < screenWidth; x += (floorX0 == ceilingX0 ? xStep : 1))
+    {
+        double floorX = basisX + x * stepX;
+        double floorY = basisY + x * stepY;
 
-            unsigned int color;
+        // the cell coord is simply got from the integer parts of floorX and floorY
+        int cellX = int(floorX);
+        int cellY = int(floorY);
 
-            // floor
-            color = floorTexture.get(tx, ty);
-            color = (color >> 1) & 8355711; // make a bit darker
-            windowManager.drawPixel(x, y, color);
+        // get the texture coordinate from the fractional part
+        int tx = int(floorTexture.getWidth() * (floorX - cellX)) & (floorTexture.getWidth() - 1);
+        int ty = int(floorTexture.getHeight() * (floorY - cellY)) & (floorTexture.getHeight() - 1);
 
-            // ceiling (symmetrical, at screenHeight - y - 1 instead of y)
-            color = ceilingTexture.get(tx, ty);
-            color = (color >> 1) & 8355711; // make a bit darker
-            windowManager.drawPixel(x, screenHeight - y - 1, color);
-        }
+        // floor
+        if (((x - floorX0) & (xStep - 1)) == 0)
+            drawTexel(windowManager, x, y, floor.get(tx, ty));
+
+        // ceiling (symmetrical, at screenHeight - y - 1 instead of y)
+        if (((x - ceilingX0) & (xStep - 1)) == 0)
+            drawTexel(windowManager, x, ceilingY, ceiling.get(tx, ty));
     }
 }
 
 void Raycaster::castWalls()
 {
+    switch (wallEngine)
+    {
+    case WallEngine::DDA:
+        castWallsDDA();
+        break;
+    case WallEngine::SEGMENTS:
+        castWallsSegments();
+        break;
+    case WallEngine::ADAPTIVE:
+        castWallsAdaptive();
+        break;
+    }
+    stats.columns += screenWidth;
+
     #pragma omp parallel for
     for (int x = 0; x < screenWidth; x++)
     {
-        // calculate ray position and direction
-        double cameraX = 2 * x / double(screenWidth) - 1; // x-coordinate in camera space
-        Vector<double> ray = player.generateRay(cameraX);
-        // which box of the map we're in
-        int mapX = int(player.posX());
-        int mapY = int(player.posY());
-
-        // length of ray from current position to next x or y-side
-        double sideDistX;
-        double sideDistY;
-
-        // length of ray from one x or y-side to next x or y-side
-        // these are derived as:
-        // deltaDistX = sqrt(1 + (rayDirY * rayDirY) / (rayDirX * rayDirX))
-        // deltaDistY = sqrt(1 + (rayDirX * rayDirX) / (rayDirY * rayDirY))
-        // which can be simplified to abs(|rayDir| / rayDirX) and abs(|rayDir| / rayDirY)
-        // where |rayDir| is the length of the vector (rayDirX, rayDirY). Its length,
-        // unlike (dirX, dirY) is not 1, however this does not matter, only the
-        // ratio between deltaDistX and deltaDistY matters, due to the way the DDA
-        // stepping further below works. So the values can be computed as below.
-        //  Division through zero is prevented, even though technically that's not
-        //  needed in C++ with IEEE 754 floating point values.
-        double deltaDistX = (ray.x() == 0) ? 1e30 : std::abs(1 / ray.x());
-        double deltaDistY = (ray.y() == 0) ? 1e30 : std::abs(1 / ray.y());
-
-        double perpWallDist;
-
-        // what direction to step in x or y-direction (either +1 or -1)
-        int stepX;
-        int stepY;
-
-        int hit = 0; // was there a wall hit?
-        int side;    // was a NS or a EW wall hit?
-        // calculate step and initial sideDist
-        if (ray.x() < 0)
+        // the columns not shaded in this frame see the wall of their left neighbor (or right one on the border)
+        if (!isShadedColumn(x))
         {
-            stepX = -1;
-            sideDistX = (player.posX() - mapX) * deltaDistX;
+            wallHits[x] = wallHits[x > 0 ? x - 1 : x + 1];
+            zBuffer[x] = wallHits[x].perpWallDist;
         }
         else
+            drawWallColumn(x);
+    }
+}
+
+void Raycaster::setWallEngine(WallEngine engine) { wallEngine = engine; }
+void Raycaster::setAdaptiveStep(int step) { adaptiveStep = std::max(1, step); }
+void Raycaster::setFogDistance(double distance) { fogDistance = std::max(0.0, distance); }
+const std::vector<double> &Raycaster::getZBuffer() const { return zBuffer; }
+const std::vector<WallHit> &Raycaster::getWallHits() const { return wallHits; }
+const RenderStats &Raycaster::getStats() const { return stats; }
+
+std::ostream &operator<<(std::ostream &os, const RenderStats &stats)
+{
+    if (stats.columns > 0)
+        os << "Traced wall columns: " << 100.0 * stats.tracedColumns / stats.columns << "%" << std::endl;
+    if (stats.sprites > 0)
+        os << "Sprites culled: " << 100.0 * stats.spritesOutsideFrustum / stats.sprites << "% outside the frustum, "
+           << 100.0 * stats.spritesOccluded / stats.sprites << "% behind walls" << std::endl;
+    if (stats.sprites > 0)
+        os << "Sprites in the view cone of the grid: " << 100.0 * stats.spriteCandidates / stats.sprites << "%" << std::endl;
+    if (stats.spriteSorts > 0)
+        os << "Sprite sorts repairing the previous order: " << 100.0 * stats.spriteSortRepairs / stats.spriteSorts << "%"
+           << std::endl;
+    if (stats.reconstructedPixels > 0)
+        os << "Reconstructed pixels reprojected from the previous frame: "
+           << 100.0 * stats.reprojectedPixels / stats.reconstructedPixels << "%" << std::endl;
+    return os;
+}
+
+WallEngine Raycaster::parseWallEngine(const std::string &name)
+{
+    if (name == "dda")
+        return WallEngine::DDA;
+    if (name == "segments")
+        return WallEngine::SEGMENTS;
+    if (name == "adaptive")
+        return WallEngine::ADAPTIVE;
+    throw std::invalid_argument("Unknown wall engine: " + name);
+}
+
+void Raycaster::castWallsDDA()
+{
+    // only the shaded columns are traced in the interlaced mode
+    int x0 = 0, xStep = 1;
+    if (renderMode == RenderMode::INTERLACED)
+    {
+        x0 = frameParity;
+        xStep = 2;
+    }
+    #pragma omp parallel for
+    for (int x = x0; x < screenWidth; x += xStep)
+        traceColumn(x, wallHits[x]);
+    stats.tracedColumns += (screenWidth - x0 + xStep - 1) / xStep;
+}
+
+void Raycaster::castWallsAdaptive()
+{
+    // trace every adaptiveStep-th column, and the last one so that every gap is closed on both sides
+    int gaps = (screenWidth - 1 + adaptiveStep - 1) / adaptiveStep;
+    #pragma omp parallel for
+    for (int i = 0; i <= gaps; i++)
+    {
+        int x = std::min(i * adaptiveStep, screenWidth - 1);
+        traceColumn(x, wallHits[x]);
+    }
+
+    long traced = gaps + 1;
+    #pragma omp parallel for reduction(+ : traced) schedule(dynamic)
+    for (int i = 0; i < gaps; i++)
+        traced += fillColumns(i * adaptiveStep, std::min((i + 1) * adaptiveStep, screenWidth - 1));
+    stats.tracedColumns += traced;
+}
+
+int Raycaster::fillColumns(int x0, int x1)
+{
+    if (x1 - x0 <= 1)
+        return 0;
+
+    const WallHit &left = wallHits[x0], &right = wallHits[x1];
+    if (left.mapX == right.mapX && left.mapY == right.mapY && left.side == right.side)
+    {
+        // The inverse of the distance to a plane is linear along the screen, as the camera-space ray is linear in
+        // cameraX: interpolating it gives the exact distance of the face, and then the exact texX.
+        double invDist0 = 1 / left.perpWallDist, invDist1 = 1 / right.perpWallDist;
+        for (int x = x0 + 1; x < x1; x++)
         {
-            stepX = 1;
-            sideDistX = (mapX + 1.0 - player.posX()) * deltaDistX;
+            double t = double(x - x0) / (x1 - x0);
+            WallHit &hit = wallHits[x];
+            hit.perpWallDist = 1 / (invDist0 + t * (invDist1 - invDist0));
+            hit.mapX = left.mapX;
+            hit.mapY = left.mapY;
+            hit.side = left.side;
+            computeTexX(hit, player.generateRay(2 * x / double(screenWidth) - 1));
         }
-        if (ray.y() < 0)
+        return 0;
+    }
+
+    // the ends see different faces: refine both halves
+    int middle = (x0 + x1) / 2;
+    traceColumn(middle, wallHits[middle]);
+    return 1 + fillColumns(x0, middle) + fillColumns(middle, x1);
+}
+
+void Raycaster::traceColumn(int x, WallHit &hit) const
+{
+    // calculate ray position and direction
+    double cameraX = 2 * x / double(screenWidth) - 1; // x-coordinate in camera space
+    Vector<double> ray = player.generateRay(cameraX);
+    // which box of the map we're in
+    int mapX = int(player.posX());
+    int mapY = int(player.posY());
+
+    // length of ray from current position to next x or y-side
+    double sideDistX;
+    double sideDistY;
+
+    // length of ray from one x or y-side to next x or y-side
+    // these are derived as:
+    // deltaDistX = sqrt(1 + (rayDirY * rayDirY) / (rayDirX * rayDirX))
+    // deltaDistY = sqrt(1 + (rayDirX * rayDirX) / (rayDirY * rayDirY))
+    // which can be simplified to abs(|rayDir| / rayDirX) and abs(|rayDir| / rayDirY)
+    // where |rayDir| is the length of the vector (rayDirX, rayDirY). Its length,
+    // unlike (dirX, dirY) is not 1, however this does not matter, only the
+    // ratio between deltaDistX and deltaDistY matters, due to the way the DDA
+    // stepping further below works. So the values can be computed as below.
+    //  Division through zero is prevented, even though technically that's not
+    //  needed in C++ with IEEE 754 floating point values.
+    double deltaDistX = (ray.x() == 0) ? 1e30 : std::abs(1 / ray.x());
+    double deltaDistY = (ray.y() == 0) ? 1e30 : std::abs(1 / ray.y());
+
+    double perpWallDist;
+
+    // what direction to step in x or y-direction (either +1 or -1)
+    int stepX;
+    int stepY;
+
+    int hitWall = 0; // was there a wall hit?
+    int side;        // was a NS or a EW wall hit?
+    // calculate step and initial sideDist
+    if (ray.x() < 0)
+    {
+        stepX = -1;
+        sideDistX = (player.posX() - mapX) * deltaDistX;
+    }
+    else
+    {
+        stepX = 1;
+        sideDistX = (mapX + 1.0 - player.posX()) * deltaDistX;
+    }
+    if (ray.y() < 0)
+    {
+        stepY = -1;
+        sideDistY = (player.posY() - mapY) * deltaDistY;
+    }
+    else
+    {
+        stepY = 1;
+        sideDistY = (mapY + 1.0 - player.posY()) * deltaDistY;
+    }
+    // perform DDA
+    while (hitWall == 0)
+    {
+        // jump to next map square, either in x-direction, or in y-direction
+        if (sideDistX < sideDistY)
         {
-            stepY = -1;
-            sideDistY = (player.posY() - mapY) * deltaDistY;
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
         }
         else
         {
-            stepY = 1;
-            sideDistY = (mapY + 1.0 - player.posY()) * deltaDistY;
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
         }
-        // perform DDA
-        while (hit == 0)
+        // Check if ray has hit a wall
+        if (map.get(mapX, mapY) > 0)
+            hitWall = 1;
+    }
+    // Calculate distance projected on camera direction. This is the shortest distance from the point where the wall is
+    // hit to the camera plane. Euclidean to center camera point would give fisheye effect!
+    // This can be computed as (mapX - posX + (1 - stepX) / 2) / rayDirX for side == 0, or same formula with Y
+    // for size == 1, but can be simplified to the code below thanks to how sideDist and deltaDist are computed:
+    // because they were left scaled to |rayDir|. sideDist is the entire length of the ray above after the multiple
+    // steps, but we subtract deltaDist once because one step more into the wall was taken above.
+    if (side == 0)
+        perpWallDist = (sideDistX - deltaDistX);
+    else
+        perpWallDist = (sideDistY - deltaDistY);
+
+    hit.perpWallDist = perpWallDist;
+    hit.mapX = mapX;
+    hit.mapY = mapY;
+    hit.side = side;
+    computeTexX(hit, ray);
+}
+
+void Raycaster::computeTexX(WallHit &hit, const Vector<double> &ray) const
+{
+    const Texture &texture = map.getTexture(hit.mapX, hit.mapY);
+
+    // calculate value of wallX
+    double wallX; // where exactly the wall was hit
+    if (hit.side == 0)
+        wallX = player.posY() + hit.perpWallDist * ray.y();
+    else
+        wallX = player.posX() + hit.perpWallDist * ray.x();
+    wallX -= floor(wallX);
+
+    // x coordinate on the texture
+    hit.texX = int(wallX * double(texture.getWidth()));
+    if (hit.side == 0 && ray.x() > 0)
+        hit.texX = texture.getWidth() - hit.texX - 1;
+    if (hit.side == 1 && ray.y() < 0)
+        hit.texX = texture.getWidth() - hit.texX - 1;
+}
+
+void Raycaster::castWallsSegments()
+{
+    double posX = player.posX(), posY = player.posY();
+    double invDet = 1.0 / (player.camX() * player.dirY() - player.dirX() * player.camY());
+
+    // Depth under which the faces are clipped: faces crossing the camera plane are only kept in front of it.
+    const double nearDepth = 1e-6;
+    // Tolerance on the ends of a segment, so that rays going exactly through a corner are not missed by both faces.
+    const double cornerEpsilon = 1e-9;
+    // Distance to a tile corner (or texel boundary) under which a hit is left to the DDA, whose tie rule decides which
+    // side the ray takes.
+    const double cornerTolerance = 1e-7;
+
+    // gather the segments facing the player, clip them to the camera plane and project them once
+    visibleSegments.clear();
+    segmentDepths.clear();
+    segmentColumns.clear();
+    for (const WallSegment &segment : wallSegments.get())
+    {
+        // back-face culling: the wall cells must lie beyond the line, as seen from the player
+        double pos = segment.side == 0 ? posX : posY;
+        if ((segment.facing > 0) != (pos < segment.coord))
+            continue;
+
+        // transform both ends with the inverse camera matrix (see castSprites)
+        double depth[2], screenX[2];
+        for (int i = 0; i < 2; i++)
         {
-            // jump to next map square, either in x-direction, or in y-direction
-            if (sideDistX < sideDistY)
-            {
-                sideDistX += deltaDistX;
-                mapX += stepX;
-                side = 0;
-            }
-            else
+            double along = i == 0 ? segment.start : segment.end;
+            double dx = (segment.side == 0 ? segment.coord : along) - posX;
+            double dy = (segment.side == 0 ? along : segment.coord) - posY;
+            screenX[i] = invDet * (player.dirY() * dx - player.dirX() * dy);
+            depth[i] = invDet * (-player.camY() * dx + player.camX() * dy);
+        }
+        if (depth[0] < nearDepth && depth[1] < nearDepth)
+            continue;
+        // clip the end behind the camera plane
+        for (int i = 0; i < 2; i++)
+            if (depth[i] < nearDepth)
             {
-                sideDistY += deltaDistY;
-                mapY += stepY;
-                side = 1;
+                double t = (nearDepth - depth[i]) / (depth[1 - i] - depth[i]);
+                screenX[i] += t * (screenX[1 - i] - screenX[i]);
+                depth[i] = nearDepth;
             }
-            // Check if ray has hit a wall
-            if (map.get(mapX, mapY) > 0)
-                hit = 1;
-        }
-        // Calculate distance projected on camera direction. This is the shortest distance from the point where the wall is
-        // hit to the camera plane. Euclidean to center camera point would give fisheye effect!
-        // This can be computed as (mapX - posX + (1 - stepX) / 2) / rayDirX for side == 0, or same formula with Y
-        // for size == 1, but can be simplified to the code below thanks to how sideDist and deltaDist are computed:
-        // because they were left scaled to |rayDir|. sideDist is the entire length of the ray above after the multiple
-        // steps, but we subtract deltaDist once because one step more into the wall was taken above.
-        if (side == 0)
-            perpWallDist = (sideDistX - deltaDistX);
-        else
-            perpWallDist = (sideDistY - deltaDistY);
+        for (int i = 0; i < 2; i++)
+            screenX[i] = (screenWidth / 2.0) * (1 + screenX[i] / depth[i]);
+
+        // one column of margin on both sides, the exact extent is checked per column
+        double left = std::min(screenX[0], screenX[1]), right = std::max(screenX[0], screenX[1]);
+        if (right < -1 || left > screenWidth)
+            continue;
+        int x0 = std::max(0, int(floor(std::max(left, -1.0))) - 1);
+        int x1 = std::min(screenWidth - 1, int(ceil(std::min(right, double(screenWidth)))) + 1);
+
+        visibleSegments.push_back(segment);
+        segmentDepths.push_back(std::min(depth[0], depth[1]));
+        segmentColumns.push_back({x0, x1});
+    }
 
-        int lineHeight = int(screenHeight / perpWallDist);
+    // front to back order of the nearest depth of the segments
+    segmentOrder.resize(visibleSegments.size());
+    for (size_t i = 0; i < segmentOrder.size(); i++)
+        segmentOrder[i] = i;
+    std::sort(segmentOrder.begin(), segmentOrder.end(), [this](int a, int b)
+              { return segmentDepths[a] < segmentDepths[b]; });
 
-        int drawStart = -lineHeight / 2 + screenHeight / 2;
-        if (drawStart < 0)
-            drawStart = 0;
-        int drawEnd = lineHeight / 2 + screenHeight / 2;
-        if (drawEnd >= screenHeight)
-            drawEnd = screenHeight - 1;
+    for (int x = 0; x <= screenWidth; x++)
+        nextOpenColumn[x] = x;
+    for (int x = 0; x < screenWidth; x++)
+    {
+        wallHits[x].perpWallDist = std::numeric_limits<double>::infinity();
+        cornerDistances[x] = std::numeric_limits<double>::infinity();
+    }
 
-        Texture texture = map.getTexture(mapX, mapY);
+    // Fill the columns of every segment front to back. A column whose wall is nearer than the nearest depth of the
+    // current segment cannot change anymore, since the following segments are all farther: it is closed in the span
+    // buffer and is then skipped by all the following segments.
+    int openColumns = screenWidth;
+    for (size_t k = 0; k < segmentOrder.size() && openColumns > 0; k++)
+    {
+        int i = segmentOrder[k];
+        const WallSegment &segment = visibleSegments[i];
+        double minDepth = segmentDepths[i];
+        double pos = segment.side == 0 ? posX : posY;
+        double other = segment.side == 0 ? posY : posX;
 
-        // calculate value of wallX
-        double wallX; // where exactly the wall was hit
-        if (side == 0)
-            wallX = player.posY() + perpWallDist * ray.y();
-        else
-            wallX = player.posX() + perpWallDist * ray.x();
-        wallX -= floor(wallX);
+        for (int x = findOpenColumn(segmentColumns[i].first); x <= segmentColumns[i].second; x = findOpenColumn(x + 1))
+        {
+            WallHit &hit = wallHits[x];
+            if (hit.perpWallDist <= minDepth)
+            {
+                nextOpenColumn[x] = x + 1;
+                openColumns--;
+                continue;
+            }
 
-        // x coordinate on the texture
-        int texX = int(wallX * double(texture.getWidth()));
-        if (side == 0 && ray.x() > 0)
-            texX = texture.getWidth() - texX - 1;
-        if (side == 1 && ray.y() < 0)
-            texX = texture.getWidth() - texX - 1;
+            double cameraX = 2 * x / double(screenWidth) - 1;
+            Vector<double> ray = player.generateRay(cameraX);
+            double rayAlong = segment.side == 0 ? ray.x() : ray.y();
+            double rayOther = segment.side == 0 ? ray.y() : ray.x();
+            if ((rayAlong > 0) != (segment.facing > 0))
+                continue;
+
+            // same distance as the DDA: (mapX - posX + (1 - stepX) / 2) / rayDirX for side == 0
+            double perpWallDist = (segment.coord - pos) / rayAlong;
+            double hitOther = other + perpWallDist * rayOther;
+            // A ray through a tile corner, at the end of a face, between two diagonal wall cells or between two cells
+            // of a face, may go either way: the nearest such corner is remembered to trace the column if it is not
+            // behind the wall seen.
+            if (std::abs(hitOther - std::round(hitOther)) < cornerTolerance)
+                cornerDistances[x] = std::min(cornerDistances[x], perpWallDist);
+            if (hitOther < segment.start - cornerEpsilon || hitOther > segment.end + cornerEpsilon ||
+                perpWallDist >= hit.perpWallDist)
+                continue;
+
+            // a hit within the tolerance but just outside of the segment is only kept if it enters a wall cell
+            int cell = int(floor(hitOther));
+            int line = segment.facing > 0 ? segment.coord : segment.coord - 1;
+            int mapX = segment.side == 0 ? line : cell;
+            int mapY = segment.side == 0 ? cell : line;
+            if ((cell < segment.start || cell >= segment.end) &&
+                (mapX < 0 || mapX >= map.getWidth() || mapY < 0 || mapY >= map.getHeight() || map.get(mapX, mapY) <= 0))
+                continue;
+
+            hit.perpWallDist = perpWallDist;
+            hit.mapX = mapX;
+            hit.mapY = mapY;
+            hit.side = segment.side;
+            computeTexX(hit, ray);
+            // a hit on the boundary of two texels may round to either of them
+            int textureWidth = map.getTexture(mapX, mapY).getWidth();
+            double texel = hitOther * textureWidth;
+            if (std::abs(texel - std::round(texel)) < cornerTolerance * textureWidth)
+                cornerDistances[x] = std::min(cornerDistances[x], perpWallDist);
+        }
+    }
 
-        windowManager.drawVertLine(x, drawStart, drawEnd, lineHeight, texture, texX, side == 1);
+    // the columns seeing no face at all (only possible outside of a closed map), and those passing by a tile corner in
+    // front of their wall, fall back to a traced ray, so that they see the same walls as with the DDA
+    for (int x = 0; x < screenWidth; x++)
+        if (std::isinf(wallHits[x].perpWallDist) || cornerDistances[x] <= wallHits[x].perpWallDist * (1 + cornerTolerance))
+        {
+            traceColumn(x, wallHits[x]);
+            stats.tracedColumns++;
+        }
+}
 
-        zBuffer[x] = perpWallDist;
+int Raycaster::findOpenColumn(int x)
+{
+    // path halving keeps the chains of closed columns short
+    while (nextOpenColumn[x] != x)
+    {
+        nextOpenColumn[x] = nextOpenColumn[nextOpenColumn[x]];
+        x = nextOpenColumn[x];
     }
+    return x;
 }
 
-void Raycaster::castSprites()
+void Raycaster::drawWallColumn(int x)
 {
-    std::vector<Sprite> sprites = map.getSprites();
+    const WallHit &hit = wallHits[x];
 
-    int screenWidth = windowManager.getWidth();
-    int screenHeight = windowManager.getHeight();
+    int lineHeight = int(screenHeight / hit.perpWallDist);
 
-    // sort sprites from far to close
-    #pragma omp parallel for
-    for (int i = 0; i < numSprites; i++)
-    {
-        spriteOrder[i] = i;
-        Sprite sprite = sprites[i];
-        spriteDistance[i] = pow(player.posX() - sprite.posX(), 2) + pow(player.posY() - sprite.posY(), 2); // sqrt not taken, unneeded
-    }
+    int drawStart = -lineHeight / 2 + screenHeight / 2;
+    if (drawStart < 0)
+        drawStart = 0;
+    int drawEnd = lineHeight / 2 + screenHeight / 2;
+    if (drawEnd >= screenHeight)
+        drawEnd = screenHeight - 1;
+
+    const Texture &texture = map.getTexture(hit.mapX, hit.mapY);
+
+    // the sides facing along y are darker
+    int shade = shadeAt(hit.perpWallDist, hit.side == 1 ? Texture::shadesPerHalving : 0);
+    windowManager.drawVertLine(x, firstShadedRow(x, drawStart), drawEnd, lineHeight, texture, hit.texX, shade, shadedRowStep());
+
+    zBuffer[x] = hit.perpWallDist;
+}
 
+void Raycaster::castSprites()
+{
+    const SpritePool &sprites = map.getSprites();
+
+    // Only the sprites of the cells of the grid in the view cone are considered, converted from ids to slots. A sprite
+    // is as wide as high: its half-width spans screenHeight / 2 columns at depth 1, i.e. this part of the camera plane.
+    double spriteHalfWidth = double(screenHeight) / screenWidth * std::hypot(player.camX(), player.camY());
+    map.getSpriteGrid().queryCone(player.posX(), player.posY(), player.dirX(), player.dirY(), player.camX(), player.camY(),
+                                  spriteHalfWidth, spriteCandidates);
+    for (int &candidate : spriteCandidates)
+        candidate = sprites.slotOf(candidate);
+
+    // project all the sprites at once: the distances, the transformation with the inverse camera matrix
+    //  [ planeX   dirX ] -1                                       [ dirY      -dirX ]
+    //  [               ]       =  1/(planeX*dirY-dirX*planeY) *   [                 ]
+    //  [ planeY   dirY ]                                          [ -planeY  planeX ]
+    // and the screen bounds are computed by the vectorized kernel of the pool
+    sprites.project(player.posX(), player.posY(), player.dirX(), player.dirY(), player.camX(), player.camY(),
+                    screenWidth, screenHeight, spriteProjections);
+
+    // only the sprites that may be visible are sorted from far to close and drawn
+    cullSprites();
     sortSprites();
 
-    // after sorting the sprites, do the projection and draw them
+    // after sorting the sprites, draw them
     #pragma omp parallel for
     for (int i = 0; i < numSprites; i++)
     {
-        Sprite sprite = sprites[spriteOrder[i]];
-
-        // translate sprite position to relative to camera
-        double spriteX = sprite.posX() - player.posX();
-        double spriteY = sprite.posY() - player.posY();
-
-        // transform sprite with the inverse camera matrix
-        //  [ planeX   dirX ] -1                                       [ dirY      -dirX ]
-        //  [               ]       =  1/(planeX*dirY-dirX*planeY) *   [                 ]
-        //  [ planeY   dirY ]                                          [ -planeY  planeX ]
-
-        double invDet = 1.0 / (player.camX() * player.dirY() - player.dirX() * player.camY()); // required for correct matrix multiplication
-
-        double transformX = invDet * (player.dirY() * spriteX - player.dirX() * spriteY);
-        double transformY = invDet * (-player.camY() * spriteX + player.camX() * spriteY); // this is actually the depth inside the screen, that what Z is in 3D
+        int slot = spriteOrder[i];
+        const Texture &texture = map.getSpriteTexture(sprites.textureId()[slot]);
+        const OpaqueSpans &spans = map.getSpriteSpans(sprites.textureId()[slot]);
 
-        int spriteScreenX = int((screenWidth / 2) * (1 + transformX / transformY));
+        double transformY = spriteProjections.transformY[slot]; // this is actually the depth inside the screen, that what Z is in 3D
+        int spriteScreenX = spriteProjections.screenX[slot];
 
         // calculate height of the sprite on screen
-        int spriteHeight = abs(int(screenHeight / (transformY))); // using 'transformY' instead of the real distance prevents fisheye
+        int spriteHeight = spriteProjections.size[slot]; // using 'transformY' instead of the real distance prevents fisheye
         // calculate lowest and highest pixel to fill in current stripe
         int drawStartY = -spriteHeight / 2 + screenHeight / 2;
         if (drawStartY < 0)
@@ -246,52 +643,321 @@ void Raycaster::castSprites()
         if (drawEndY >= screenHeight)
             drawEndY = screenHeight - 1;
 
-        // calculate width of the sprite
-        int spriteWidth = abs(int(screenHeight / (transformY)));
-        int drawStartX = -spriteWidth / 2 + spriteScreenX;
-        if (drawStartX < 0)
-            drawStartX = 0;
-        int drawEndX = spriteWidth / 2 + spriteScreenX;
-        if (drawEndX >= screenWidth)
-            drawEndX = screenWidth - 1;
+        // width of the sprite and columns covered on the screen
+        int spriteWidth = spriteProjections.size[slot];
+        int drawStartX = spriteProjections.drawStartX[slot];
+        int drawEndX = spriteProjections.drawEndX[slot];
+        bool unoccluded = spriteUnoccluded[slot];
+        int shade = shadeAt(transformY, 0);
 
         // loop through every vertical stripe of the sprite on screen
         for (int stripe = drawStartX; stripe < drawEndX; stripe++)
         {
-            int texX = int(256 * (stripe - (-spriteWidth / 2 + spriteScreenX)) * sprite.getWidth() / spriteWidth) / 256;
+            if (!isShadedColumn(stripe))
+                continue;
+
+            int texX = int(256 * (stripe - (-spriteWidth / 2 + spriteScreenX)) * texture.getWidth() / spriteWidth) / 256;
+            texX &= texture.getWidth() - 1;
             // the conditions in the if are:
             // 1) it's in front of camera plane so you don't see things behind you
             // 2) it's on the screen (left)
             // 3) it's on the screen (right)
             // 4) ZBuffer, with perpendicular distance
-            if (transformY > 0 && stripe > 0 && stripe < screenWidth && transformY < zBuffer[stripe])
-                for (int y = drawStartY; y < drawEndY; y++) // for every pixel of the current stripe
+            if (!(transformY > 0 && stripe > 0 && stripe < screenWidth && (unoccluded || transformY < zBuffer[stripe])))
+                continue;
+
+            drawSpriteColumn(stripe, texX, spans, drawStartY, drawEndY, spriteHeight, texture, shade);
+        }
+    }
+}
+
+void Raycaster::drawSpriteColumn(int stripe, int texX, const OpaqueSpans &spans, int drawStartY, int drawEndY, int spriteHeight,
+                                 const Texture &texture, int shade)
+{
+    // the format and the storage of the texture are chosen once per column, the texels are written without conversion
+    bool rgb565 = windowManager.getFormat() == FramebufferFormat::RGB565;
+    int textureHeight = texture.getHeight();
+    if (rgb565 && texture.isIndexed())
+        drawSpriteTexels(stripe, texX, spans, drawStartY, drawEndY, spriteHeight, textureHeight, TextureSampler<unsigned short, true>(texture, shade));
+    else if (rgb565)
+        drawSpriteTexels(stripe, texX, spans, drawStartY, drawEndY, spriteHeight, textureHeight, TextureSampler<unsigned short, false>(texture, shade));
+    else if (texture.isIndexed())
+        drawSpriteTexels(stripe, texX, spans, drawStartY, drawEndY, spriteHeight, textureHeight, TextureSampler<unsigned int, true>(texture, shade));
+    else
+        drawSpriteTexels(stripe, texX, spans, drawStartY, drawEndY, spriteHeight, textureHeight, TextureSampler<unsigned int, false>(texture, shade));
+}
+
+template <typename Sampler>
+void Raycaster::drawSpriteTexels(int stripe, int texX, const OpaqueSpans &spans, int drawStartY, int drawEndY, int spriteHeight,
+                                 int textureHeight, Sampler sampler)
+{
+    // The texture row of spriteTexY is the quotient of (y * 256 - screenHeight * 128 + spriteHeight * 128) *
+    // textureHeight by 256 * spriteHeight. The numerator grows by the same amount every row: the quotient and the
+    // remainder are stepped in fixed point instead of dividing for every pixel, giving exactly the same rows.
+    int yStep = shadedRowStep();
+    long denominator = 256L * spriteHeight;
+    long increment = 256L * textureHeight * yStep;
+    int quotientStep = increment / denominator;
+    long remainderStep = increment % denominator;
+
+    // only the opaque runs of the column are drawn (black is the invisible color): the gaps are skipped and the pixels
+    // of a run are painted without testing them
+    const OpaqueSpan *runs = spans.get(texX);
+    for (int r = 0; r < spans.count(texX); r++)
+    {
+        int runStart = firstSpriteRow(runs[r].start, drawStartY, drawEndY, screenHeight, spriteHeight, textureHeight);
+        int runEnd = firstSpriteRow(runs[r].end, drawStartY, drawEndY, screenHeight, spriteHeight, textureHeight);
+        int y = firstShadedRow(stripe, runStart);
+        long numerator = long(y * 256 - screenHeight * 128 + spriteHeight * 128) * textureHeight;
+        // above the middle of the first texel row the numerator is negative, and spriteTexY truncates towards zero
+        for (; y < runEnd && numerator < 0; y += yStep, numerator += increment)
+            drawTexel(windowManager, stripe, y, sampler.get(texX, spriteTexY(y, screenHeight, spriteHeight, textureHeight)));
+        int texY = numerator / denominator;
+        long remainder = numerator % denominator;
+        for (; y < runEnd; y += yStep)
+        {
+            drawTexel(windowManager, stripe, y, sampler.get(texX, texY));
+            texY += quotientStep;
+            remainder += remainderStep;
+            if (remainder >= denominator)
+            {
+                remainder -= denominator;
+                texY++;
+            }
+        }
+    }
+}
+
+void Raycaster::cullSprites()
+{
+    const SpritePool &sprites = map.getSprites();
+    depthPyramid.build(zBuffer);
+
+    numSprites = 0;
+    long outsideFrustum = 0, occluded = 0;
+    for (int i : spriteCandidates)
+    {
+        // behind the camera plane, outside of the left and right planes of the frustum, or hidden
+        if (!spriteProjections.visible[i])
+        {
+            outsideFrustum++;
+            continue;
+        }
+
+        // The sprite is hidden if the walls of all its columns are nearer than it, and fully visible if all of them
+        // are farther. Column 0 is never drawn (see castSprites).
+        double transformY = spriteProjections.transformY[i];
+        double minDepth, maxDepth;
+        depthPyramid.range(std::max(spriteProjections.drawStartX[i], 1), spriteProjections.drawEndX[i], minDepth, maxDepth);
+        if (transformY >= maxDepth)
+        {
+            occluded++;
+            continue;
+        }
+        spriteUnoccluded[i] = transformY < minDepth;
+
+        spriteOrder[numSprites] = i;
+        spriteDistance[numSprites] = spriteProjections.distance[i];
+        numSprites++;
+    }
+
+    // the sprites outside of the view cone were culled by the grid
+    outsideFrustum += sprites.size() - int(spriteCandidates.size());
+    stats.sprites += sprites.size();
+    stats.spriteCandidates += spriteCandidates.size();
+    stats.spritesOutsideFrustum += outsideFrustum;
+    stats.spritesOccluded += occluded;
+}
+
+void Raycaster::sortSprites()
+{
+    long repairs = spriteSorter.getStats().repairs;
+    spriteSorter.sort(spriteOrder.data(), spriteDistance.data(), numSprites);
+    stats.spriteSorts++;
+    stats.spriteSortRepairs += spriteSorter.getStats().repairs - repairs;
+}
+
+int Raycaster::shadeAt(double distance, int offset) const
+{
+    int shade = offset;
+    if (fogDistance > 0)
+        shade += int(std::min(Texture::shadesPerHalving * distance / fogDistance, double(Texture::shadeLevels)));
+    return std::min(shade, Texture::shadeLevels - 1);
+}
+
+void Raycaster::setRenderMode(RenderMode mode)
+{
+    renderMode = mode;
+    if (mode != RenderMode::FULL)
+        windowManager.keepPreviousFrame();
+}
+
+RenderMode Raycaster::parseRenderMode(const std::string &name)
+{
+    if (name == "full")
+        return RenderMode::FULL;
+    if (name == "checkerboard")
+        return RenderMode::CHECKERBOARD;
+    if (name == "interlaced")
+        return RenderMode::INTERLACED;
+    throw std::invalid_argument("Unknown render mode: " + name);
+}
+
+bool Raycaster::isShadedColumn(int x) const
+{
+    return renderMode != RenderMode::INTERLACED || (x & 1) == frameParity;
+}
+
+int Raycaster::firstShadedColumn(int y) const
+{
+    switch (renderMode)
+    {
+    case RenderMode::CHECKERBOARD:
+        return (y ^ frameParity) & 1;
+    case RenderMode::INTERLACED:
+        return frameParity;
+    default:
+        return 0;
+    }
+}
+
+int Raycaster::firstShadedRow(int x, int y) const
+{
+    return renderMode == RenderMode::CHECKERBOARD ? y + ((x ^ y ^ frameParity) & 1) : y;
+}
+
+int Raycaster::shadedColumnStep() const { return renderMode == RenderMode::FULL ? 1 : 2; }
+int Raycaster::shadedRowStep() const { return renderMode == RenderMode::CHECKERBOARD ? 2 : 1; }
+
+void Raycaster::finishFrame()
+{
+    if (renderMode != RenderMode::FULL)
+    {
+        // Beyond these thresholds, the disocclusions between the two frames are too large for the reprojection.
+        const double maxMove = 0.25, maxTurn = 0.2;
+        double moveX = player.posX() - prevPosX, moveY = player.posY() - prevPosY;
+        double turn = std::abs(atan2(player.dirX() * prevDirY - player.dirY() * prevDirX,
+                                     player.dirX() * prevDirX + player.dirY() * prevDirY));
+        bool reproject = hasPreviousFrame && moveX * moveX + moveY * moveY <= maxMove * maxMove && turn <= maxTurn;
+        // Without translation, the ratio of the depths of a point in both frames only depends on its column:
+        // every pixel, on the floor or not, is then reprojected like a wall pixel.
+        bool rotationOnly = moveX == 0 && moveY == 0;
+
+        double posZ = 0.5 * screenHeight;
+        double prevInvDet = 1.0 / (prevCamX * prevDirY - prevDirX * prevCamY);
+
+        // The wall point seen through a column is the same for all its rows: it is reprojected once per column.
+        // Its height only scales its distance to the horizon, by the ratio of its depths in both frames.
+        #pragma omp parallel for
+        for (int x = 0; x < screenWidth; x++)
+        {
+            ColumnReprojection &column = columnReprojections[x];
+            Vector<double> ray = player.generateRay(2 * x / double(screenWidth) - 1);
+            column.rayX = ray.x();
+            column.rayY = ray.y();
+
+            double depth = wallHits[x].perpWallDist;
+            int lineHeight = int(screenHeight / depth);
+            column.drawStart = -lineHeight / 2 + screenHeight / 2;
+            column.drawEnd = lineHeight / 2 + screenHeight / 2;
+
+            // transform the wall point with the inverse camera matrix of the previous frame (see castSprites)
+            double dx = player.posX() + depth * ray.x() - prevPosX;
+            double dy = player.posY() + depth * ray.y() - prevPosY;
+            double prevDepth = prevInvDet * (-prevCamY * dx + prevCamX * dy);
+            column.prevX = (screenWidth / 2.0) * (1 + prevInvDet * (prevDirY * dx - prevDirX * dy) / prevDepth);
+            column.depthRatio = prevDepth > 0 ? depth / prevDepth : -1;
+        }
+
+        long reconstructed = 0, reprojected = 0;
+        #pragma omp parallel for reduction(+ : reconstructed, reprojected)
+        for (int y = 0; y < screenHeight; y++)
+        {
+            // columns of the row missing in this frame
+            int x0 = renderMode == RenderMode::CHECKERBOARD ? (y ^ frameParity ^ 1) & 1 : frameParity ^ 1;
+
+            // the floor (or ceiling) point seen through a pixel is at the distance of its row
+            int floorY = y < screenHeight / 2 ? screenHeight - y - 1 : y; // the floor row mirroring a ceiling row
+            double floorDepth = posZ / (floorY - screenHeight / 2);
+
+            for (int x = x0; x < screenWidth; x += 2)
+            {
+                reconstructed++;
+                const ColumnReprojection &column = columnReprojections[x];
+                if (!reproject)
+                {
+                    spatialFillPixel(x, y);
+                    continue;
+                }
+
+                double prevX, prevY;
+                if (rotationOnly || (y >= column.drawStart && y <= column.drawEnd))
                 {
-                    int d = (y) * 256 - screenHeight * 128 + spriteHeight * 128; // 256 and 128 factors to avoid floats
-                    int texY = ((d * sprite.getHeight()) / spriteHeight) / 256;
-                    unsigned int color = sprite.get(texX, texY); // get current color from the texture
-                    if ((color & 0x00FFFFFF) != 0)
-                        windowManager.drawPixel(stripe, y, color); // paint pixel if it isn't black, black is the invisible color
+                    if (column.depthRatio < 0)
+                    {
+                        spatialFillPixel(x, y);
+                        continue;
+                    }
+                    prevX = column.prevX;
+                    prevY = screenHeight / 2 + (y - screenHeight / 2) * column.depthRatio;
                 }
+                else
+                {
+                    double dx = player.posX() + floorDepth * column.rayX - prevPosX;
+                    double dy = player.posY() + floorDepth * column.rayY - prevPosY;
+                    double prevDepth = prevInvDet * (-prevCamY * dx + prevCamX * dy);
+                    if (!(prevDepth > 0))
+                    {
+                        spatialFillPixel(x, y);
+                        continue;
+                    }
+                    prevX = (screenWidth / 2.0) * (1 + prevInvDet * (prevDirY * dx - prevDirX * dy) / prevDepth);
+                    prevY = screenHeight / 2 + posZ / prevDepth;
+                    if (y < screenHeight / 2)
+                        prevY = screenHeight - prevY - 1;
+                }
+                reprojected += reprojectPixel(x, y, prevX, prevY);
+            }
         }
+        stats.reconstructedPixels += reconstructed;
+        stats.reprojectedPixels += reprojected;
     }
+
+    prevPosX = player.posX();
+    prevPosY = player.posY();
+    prevDirX = player.dirX();
+    prevDirY = player.dirY();
+    prevCamX = player.camX();
+    prevCamY = player.camY();
+    hasPreviousFrame = true;
+    frameParity ^= 1;
 }
 
-void Raycaster::sortSprites()
+bool Raycaster::reprojectPixel(int x, int y, double prevX, double prevY)
 {
-    std::vector<std::pair<double, int>> sprites(numSprites);
-    #pragma omp parallel for
-    for (int i = 0; i < numSprites; i++)
+    // rounded to the nearest pixel (the bounds are checked first, as the conversion truncates towards zero)
+    prevX += 0.5;
+    prevY += 0.5;
+    if (!(prevX >= 0 && prevX < screenWidth && prevY >= 0 && prevY < screenHeight))
     {
-        sprites[i].first = spriteDistance[i];
-        sprites[i].second = spriteOrder[i];
+        spatialFillPixel(x, y);
+        return false;
     }
-    std::sort(sprites.begin(), sprites.end());
-    // restore in reverse order to go from farthest to nearest
-    #pragma omp parallel for
-    for (int i = 0; i < numSprites; i++)
+    windowManager.drawPixel(x, y, windowManager.getPreviousPixel(int(prevX), int(prevY)));
+    return true;
+}
+
+void Raycaster::spatialFillPixel(int x, int y)
+{
+    // the shaded neighbors are the left and right pixels, and also the top and bottom ones in the checkerboard mode
+    unsigned int left = windowManager.getPixel(x > 0 ? x - 1 : x + 1, y);
+    unsigned int right = windowManager.getPixel(x < screenWidth - 1 ? x + 1 : x - 1, y);
+    unsigned int color = averageColor(left, right);
+    if (renderMode == RenderMode::CHECKERBOARD)
     {
-        spriteDistance[i] = sprites[numSprites - i - 1].first;
-        spriteOrder[i] = sprites[numSprites - i - 1].second;
+        unsigned int top = windowManager.getPixel(x, y > 0 ? y - 1 : y + 1);
+        unsigned int bottom = windowManager.getPixel(x, y < screenHeight - 1 ? y + 1 : y - 1);
+        color = averageColor(color, averageColor(top, bottom));
     }
+    windowManager.drawPixel(x, y, color);
 }
\ No newline at end of file
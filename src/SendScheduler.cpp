@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+
+#include <SendScheduler.h>
+
+std::ostream &operator<<(std::ostream &os, const SendSchedulerStats &stats)
+{
+    if (stats.changes > 0)
+        os << "Position sends: " << stats.sent << " of " << stats.changes << " changes (" << stats.keyframes
+           << " keyframes), " << (stats.changes - stats.sent) / std::max(stats.seconds, 1e-3)
+           << " packets/s saved to every player" << std::endl;
+    return os;
+}
+
+SendScheduler::SendScheduler(double maxRate, double minMove, double minTurn, int keyframeInterval)
+    : interval(maxRate > 0 ? int(std::lround(1000 / maxRate)) : 0),
+      minMove(minMove),
+      minTurn(minTurn),
+      keyframeInterval(keyframeInterval),
+      hasState(false),
+      hasSent(false),
+      updated(0),
+      sentAt(0),
+      start(0)
+{
+}
+
+void SendScheduler::update(const EntityUpdate &state, uint32_t now)
+{
+    if (!hasState)
+        start = now;
+    hasState = true;
+    newest = state;
+    updated = now;
+    stats.changes++;
+}
+
+bool SendScheduler::poll(uint32_t now, EntityUpdate &state)
+{
+    uint32_t time;
+    bool keyframe;
+    if (!getSendTime(time, keyframe) || int32_t(now - time) < 0)
+        return false;
+    state = last = newest;
+    hasSent = true;
+    sentAt = now;
+    stats.sent++;
+    if (keyframe)
+        stats.keyframes++;
+    return true;
+}
+
+int SendScheduler::getWait(uint32_t now) const
+{
+    uint32_t time;
+    bool keyframe;
+    if (!getSendTime(time, keyframe))
+        return -1;
+    return std::max(int32_t(time - now), 0);
+}
+
+SendSchedulerStats SendScheduler::getStats(uint32_t now) const
+{
+    SendSchedulerStats current = stats;
+    current.seconds = hasState ? int32_t(now - start) / 1000.0 : 0;
+    return current;
+}
+
+bool SendScheduler::getSendTime(uint32_t &time, bool &keyframe) const
+{
+    if (!hasState)
+        return false;
+    keyframe = false;
+    if (!hasSent)
+    {
+        time = updated;
+        return true;
+    }
+
+    // a state moved or turned enough is sent an interval after the last one, and a smaller change once the player
+    // was still for an interval
+    double distance = std::hypot(newest.x - last.x, newest.y - last.y);
+    double rotation = std::fabs(std::remainder(newest.direction - last.direction, 2 * M_PI));
+    bool changed = distance > 0 || rotation > 0;
+    bool significant = distance >= minMove || rotation >= minTurn;
+    if (changed)
+    {
+        time = sentAt + interval;
+        if (!significant && int32_t(updated + interval - time) > 0)
+            time = updated + interval;
+    }
+    if (keyframeInterval > 0 && (!changed || int32_t(sentAt + keyframeInterval - time) < 0))
+    {
+        time = sentAt + keyframeInterval;
+        keyframe = true;
+        return true;
+    }
+    return changed;
+}
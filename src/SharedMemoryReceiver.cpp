@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <arpa/inet.h>
+
+#include <PositionPacket.h>
+#include <SharedMemoryReceiver.h>
+
+SharedMemoryReceiver::SharedMemoryReceiver(std::shared_ptr<SharedMemoryRing> ring, const std::vector<int> &ports)
+    : SharedMemoryReceiver(ring, ports, 256)
+{
+}
+
+SharedMemoryReceiver::SharedMemoryReceiver(std::shared_ptr<SharedMemoryRing> ring, const std::vector<int> &ports, int capacity)
+    : ring(ring), ports(ports), peers(ports.size()), cursors(ports.size(), 0), firstPeer(0), nextConnect(PositionPacket::now()), packets(capacity)
+{
+    connect(true);
+}
+
+int SharedMemoryReceiver::receive(int timeoutMs)
+{
+    stats.waits++;
+    connect(false);
+    int count = drain();
+    if (count == 0 && timeoutMs != 0)
+    {
+        // the writers wake the receiver up only if they see it sleeping, which it says before checking the rings a
+        // last time
+        ring->setSleeping(true);
+        uint32_t doorbell = ring->getDoorbell();
+        count = drain();
+        bool rang = count == 0 && ring->wait(doorbell, timeoutMs);
+        ring->setSleeping(false);
+        if (rang)
+        {
+            count = drain();
+            // a player that started since the last check rang before its ring was opened
+            if (count == 0)
+            {
+                connect(true);
+                count = drain();
+            }
+        }
+    }
+    if (count == 0)
+        return 0;
+    stats.wakeups++;
+    stats.packets += count;
+    return count;
+}
+
+void SharedMemoryReceiver::connect(bool force)
+{
+    uint32_t now = PositionPacket::now();
+    if (!force && int32_t(now - nextConnect) < 0)
+        return;
+    nextConnect = now + 1000;
+    for (size_t i = 0; i < peers.size(); i++)
+    {
+        if (peers[i] && !peers[i]->isAlive())
+            peers[i].reset();
+        if (peers[i])
+            continue;
+        // the packets are received from the last one written, the latest position of the player, which may be the one
+        // that rang the doorbell
+        peers[i] = SharedMemoryRing::open(ports[i]);
+        if (peers[i])
+            cursors[i] = std::max(peers[i]->getHead(), uint64_t(1)) - 1;
+    }
+}
+
+int SharedMemoryReceiver::drain()
+{
+    // the players are drained from a different one on every call: with a full ring of packets, the players drained last
+    // would otherwise always be the ones left behind
+    int count = 0, capacity = packets.size();
+    for (size_t k = 0; k < peers.size() && count < capacity; k++)
+    {
+        size_t i = (firstPeer + k) % peers.size();
+        if (!peers[i])
+            continue;
+        while (count < capacity)
+        {
+            ReceivedPacket &packet = packets[count];
+            packet.length = peers[i]->read(cursors[i], packet.data, stats.dropped);
+            if (packet.length < 0)
+                break;
+            packet.from = {};
+            packet.from.sin_family = AF_INET;
+            packet.from.sin_port = htons(ports[i]);
+            packet.from.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            count++;
+        }
+    }
+    if (!peers.empty())
+        firstPeer = (firstPeer + 1) % peers.size();
+    if (count > 0)
+        stats.batches++;
+    return count;
+}
+
+const ReceivedPacket &SharedMemoryReceiver::getPacket(int i) const { return packets[i]; }
+const SharedMemoryReceiveStats &SharedMemoryReceiver::getStats() const { return stats; }
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <SharedMemoryRing.h>
+
+static const uint32_t magicValue = 0x4d485352; // "RSHM" in little-endian order.
+
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::create(int port, int capacity)
+{
+    if (capacity <= 0)
+        throw std::invalid_argument("Invalid ring capacity");
+    std::string name = getName(port);
+    // a segment left by a previous run is replaced: its readers notice that its creator died
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create shared memory segment: " + name);
+    size_t size = sizeof(Header) + size_t(capacity) * sizeof(Slot);
+    void *mapping = ftruncate(fd, size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory segment: " + name);
+    }
+
+    // the segment is zeroed: the readers only use it once the magic is written, after the rest of the header
+    std::shared_ptr<SharedMemoryRing> ring(new SharedMemoryRing(name, true, mapping, size));
+    ring->header->version = version;
+    ring->header->pid = getpid();
+    ring->header->capacity = capacity;
+    ring->header->magic.store(magicValue, std::memory_order_release);
+    return ring;
+}
+
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::open(int port)
+{
+    std::string name = getName(port);
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && size_t(status.st_size) >= sizeof(Header))
+        mapping = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    std::shared_ptr<SharedMemoryRing> ring(new SharedMemoryRing(name, false, mapping, status.st_size));
+    const Header *header = ring->header;
+    if (header->magic.load(std::memory_order_acquire) != magicValue || header->version != version ||
+        sizeof(Header) + size_t(header->capacity) * sizeof(Slot) != ring->size || !ring->isAlive())
+        return NULL;
+    return ring;
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string &name, bool owner, void *mapping, size_t size)
+    : name(name),
+      owner(owner),
+      size(size),
+      header((Header *)mapping),
+      slots((Slot *)((unsigned char *)mapping + sizeof(Header)))
+{
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+    if (owner)
+    {
+        header->closed.store(1);
+        shm_unlink(name.c_str());
+    }
+    munmap(header, size);
+}
+
+unsigned char *SharedMemoryRing::beginWrite()
+{
+    // the slot is marked as being written before its packet changes (a seqlock)
+    uint64_t sequence = header->head.load(std::memory_order_relaxed);
+    Slot &slot = slots[sequence % header->capacity];
+    slot.sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot.data;
+}
+
+void SharedMemoryRing::endWrite(int length)
+{
+    uint64_t sequence = header->head.load(std::memory_order_relaxed);
+    Slot &slot = slots[sequence % header->capacity];
+    slot.length = length;
+    slot.sequence.store(2 * sequence + 2, std::memory_order_release);
+    header->head.store(sequence + 1);
+}
+
+uint64_t SharedMemoryRing::getHead() const { return header->head.load(); }
+
+int SharedMemoryRing::read(uint64_t &cursor, unsigned char *data, long &dropped) const
+{
+    uint64_t capacity = header->capacity;
+    for (;;)
+    {
+        uint64_t head = header->head.load();
+        if (cursor == head)
+            return -1;
+        // the packets more than a ring behind were overwritten
+        if (head - cursor > capacity)
+        {
+            dropped += head - capacity - cursor;
+            cursor = head - capacity;
+        }
+
+        // the packet is copied, then kept only if its slot was not written meanwhile
+        const Slot &slot = slots[cursor % capacity];
+        uint64_t sequence = 2 * cursor + 2;
+        if (slot.sequence.load(std::memory_order_acquire) == sequence)
+        {
+            int length = std::max(std::min(slot.length, int32_t(maxPayload)), 0);
+            memcpy(data, slot.data, length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                cursor++;
+                return length;
+            }
+        }
+        dropped++;
+        cursor++;
+    }
+}
+
+bool SharedMemoryRing::ring()
+{
+    // the doorbell is incremented before checking if the receiver sleeps, which it sets before checking the rings a
+    // last time: either the receiver sees the packet, or the writer sees it sleeping
+    header->doorbell.fetch_add(1);
+    if (!header->sleeping.load())
+        return false;
+    syscall(SYS_futex, &header->doorbell, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    return true;
+}
+
+void SharedMemoryRing::setSleeping(bool sleeping) { header->sleeping.store(sleeping); }
+uint32_t SharedMemoryRing::getDoorbell() const { return header->doorbell.load(); }
+
+bool SharedMemoryRing::wait(uint32_t doorbell, int timeoutMs)
+{
+    // the futex is shared between processes: it is not private
+    timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    syscall(SYS_futex, &header->doorbell, FUTEX_WAIT, doorbell, timeoutMs < 0 ? NULL : &timeout, NULL, 0);
+    return getDoorbell() != doorbell;
+}
+
+bool SharedMemoryRing::isAlive() const
+{
+    return header->closed.load() == 0 && (kill(header->pid, 0) == 0 || errno != ESRCH);
+}
+
+std::string SharedMemoryRing::getName(int port)
+{
+    return "/raycasting-" + std::to_string(port);
+}
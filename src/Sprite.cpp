@@ -1,16 +1,9 @@
 #include <Sprite.h>
 
-Sprite::Sprite(Vector<double> position, const Texture &texture) : position(position), texture(texture)
+Sprite::Sprite(Vector<double> position, int textureId) : position(position), textureId(textureId)
 {
 }
 
-unsigned int Sprite::get(int x, int y) const { return texture.get(x, y); }
-int Sprite::getWidth() const { return texture.getWidth(); }
-int Sprite::getHeight() const { return texture.getHeight(); }
+int Sprite::getTextureId() const { return textureId; }
 double Sprite::posX() const { return position.x(); }
-double Sprite::posY() const { return position.y(); }
-
-void Sprite::move(double x, double y)
-{
-    position = {x, y};
-}
\ No newline at end of file
+double Sprite::posY() const { return position.y(); }
\ No newline at end of file
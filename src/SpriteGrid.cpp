@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <SpriteGrid.h>
+
+SpriteGrid::SpriteGrid(int width, int height, double cellSize, int capacity) : cellsX(std::max(int(std::ceil(width / cellSize)), 1)),
+                                                                              cellsY(std::max(int(std::ceil(height / cellSize)), 1)),
+                                                                              cellSize(cellSize),
+                                                                              heads(cellsX * cellsY, -1),
+                                                                              next(capacity, -1),
+                                                                              prev(capacity, -1),
+                                                                              cells(capacity, -1),
+                                                                              xs(capacity),
+                                                                              ys(capacity)
+{
+}
+
+int SpriteGrid::getCellsX() const { return cellsX; }
+int SpriteGrid::getCellsY() const { return cellsY; }
+
+int SpriteGrid::cellAt(double x, double y) const
+{
+    // clamped in double first: the conversion of a huge value to int is undefined
+    int cellX = int(std::min(std::max(x / cellSize, 0.0), cellsX - 1.0));
+    int cellY = int(std::min(std::max(y / cellSize, 0.0), cellsY - 1.0));
+    return cellX + cellY * cellsX;
+}
+
+void SpriteGrid::link(int id, int cell)
+{
+    cells[id] = cell;
+    prev[id] = -1;
+    next[id] = heads[cell];
+    if (heads[cell] >= 0)
+        prev[heads[cell]] = id;
+    heads[cell] = id;
+}
+
+void SpriteGrid::unlink(int id)
+{
+    if (prev[id] >= 0)
+        next[prev[id]] = next[id];
+    else
+        heads[cells[id]] = next[id];
+    if (next[id] >= 0)
+        prev[next[id]] = prev[id];
+    cells[id] = -1;
+}
+
+void SpriteGrid::insert(int id, double x, double y)
+{
+    xs[id] = x;
+    ys[id] = y;
+    link(id, cellAt(x, y));
+}
+
+void SpriteGrid::remove(int id) { unlink(id); }
+
+void SpriteGrid::move(int id, double x, double y)
+{
+    xs[id] = x;
+    ys[id] = y;
+    int cell = cellAt(x, y);
+    if (cell != cells[id])
+    {
+        unlink(id);
+        link(id, cell);
+    }
+}
+
+void SpriteGrid::appendRow(int cellY, int cellX0, int cellX1, std::vector<int> &ids) const
+{
+    for (int cell = cellX0 + cellY * cellsX; cell <= cellX1 + cellY * cellsX; cell++)
+        for (int id = heads[cell]; id >= 0; id = next[id])
+            ids.push_back(id);
+}
+
+void SpriteGrid::queryCell(int cellX, int cellY, std::vector<int> &ids) const
+{
+    ids.clear();
+    if (cellX >= 0 && cellX < cellsX && cellY >= 0 && cellY < cellsY)
+        appendRow(cellY, cellX, cellX, ids);
+}
+
+void SpriteGrid::queryRadius(double x, double y, double radius, std::vector<int> &ids) const
+{
+    ids.clear();
+    int first = cellAt(x - radius, y - radius), last = cellAt(x + radius, y + radius);
+    for (int cellY = first / cellsX; cellY <= last / cellsX; cellY++)
+        for (int cell = first % cellsX + cellY * cellsX; cell <= last % cellsX + cellY * cellsX; cell++)
+            for (int id = heads[cell]; id >= 0; id = next[id])
+            {
+                double dx = xs[id] - x, dy = ys[id] - y;
+                if (dx * dx + dy * dy <= radius * radius)
+                    ids.push_back(id);
+            }
+}
+
+void SpriteGrid::queryCone(double posX, double posY, double dirX, double dirY, double camX, double camY, double margin,
+                           std::vector<int> &ids) const
+{
+    ids.clear();
+
+    // the cone is bounded by the rays through the left and right edges of the camera plane
+    double edgeX[2] = {dirX - camX, dirX + camX}, edgeY[2] = {dirY - camY, dirY + camY};
+
+    // Moving the apex back along the direction moves the edges outwards, parallel to themselves: by the distance moved
+    // times the sine of the angle between the direction and the edge.
+    double dirLength = std::hypot(dirX, dirY), sinHalfAngle = 1;
+    for (int e = 0; e < 2; e++)
+        sinHalfAngle = std::min(sinHalfAngle, std::abs(dirX * edgeY[e] - dirY * edgeX[e]) / (dirLength * std::hypot(edgeX[e], edgeY[e])));
+    double back = margin / sinHalfAngle / dirLength;
+    posX -= dirX * back;
+    posY -= dirY * back;
+    double orientation = edgeX[0] * edgeY[1] - edgeY[0] * edgeX[1];
+    // whether the cone contains the direction (sign, 0), in which case it is unbounded along x: the direction must be
+    // on the same side of both edges as the cone
+    auto containsX = [&](double sign)
+    { return -edgeY[0] * sign * orientation >= 0 && edgeY[1] * sign * orientation >= 0; };
+    bool toLeft = containsX(-1), toRight = containsX(1);
+
+    // The cone and a row of cells intersect in a convex region: its extent along x is reached at the apex, or where
+    // the edges cross the bounds of the row.
+    for (int cellY = 0; cellY < cellsY; cellY++)
+    {
+        double y0 = cellY * cellSize, y1 = y0 + cellSize;
+        double minX = std::numeric_limits<double>::infinity(), maxX = -minX;
+        if (posY >= y0 && posY <= y1)
+            minX = maxX = posX;
+        for (int e = 0; e < 2; e++)
+            for (double y : {y0, y1})
+            {
+                if (edgeY[e] == 0)
+                    continue;
+                double t = (y - posY) / edgeY[e];
+                if (t >= 0)
+                {
+                    minX = std::min(minX, posX + t * edgeX[e]);
+                    maxX = std::max(maxX, posX + t * edgeX[e]);
+                }
+            }
+        if (minX > maxX)
+            continue;
+        if (toLeft)
+            minX = 0;
+        if (toRight)
+            maxX = cellsX * cellSize;
+        if (maxX < 0 || minX >= cellsX * cellSize)
+            continue;
+
+        int cellX0 = int(std::max(minX / cellSize, 0.0));
+        int cellX1 = int(std::min(maxX / cellSize, cellsX - 1.0));
+        appendRow(cellY, cellX0, cellX1, ids);
+    }
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <SpritePool.h>
+
+void SpriteProjections::resize(int n)
+{
+    distance.resize(n);
+    transformY.resize(n);
+    screenX.resize(n);
+    size.resize(n);
+    drawStartX.resize(n);
+    drawEndX.resize(n);
+    visible.resize(n);
+}
+
+SpritePool::SpritePool(int capacity) : count(0),
+                                       xs(capacity),
+                                       ys(capacity),
+                                       textureIds(capacity),
+                                       flagBits(capacity),
+                                       slotIds(capacity),
+                                       idSlots(capacity, -1)
+{
+    // the lowest ids are given first
+    freeIds.reserve(capacity);
+    for (int id = capacity - 1; id >= 0; id--)
+        freeIds.push_back(id);
+}
+
+int SpritePool::add(double x, double y, int textureId, unsigned int flags)
+{
+    if (freeIds.empty())
+        throw std::runtime_error("Sprite pool is full");
+
+    int id = freeIds.back();
+    freeIds.pop_back();
+
+    int slot = count++;
+    xs[slot] = x;
+    ys[slot] = y;
+    textureIds[slot] = textureId;
+    flagBits[slot] = flags;
+    slotIds[slot] = id;
+    idSlots[id] = slot;
+    return id;
+}
+
+void SpritePool::remove(int id)
+{
+    int slot = idSlots[id];
+    int last = --count;
+
+    // keep the slots packed by moving the last sprite into the freed slot
+    xs[slot] = xs[last];
+    ys[slot] = ys[last];
+    textureIds[slot] = textureIds[last];
+    flagBits[slot] = flagBits[last];
+    slotIds[slot] = slotIds[last];
+    idSlots[slotIds[slot]] = slot;
+
+    idSlots[id] = -1;
+    freeIds.push_back(id);
+}
+
+void SpritePool::move(int id, double x, double y)
+{
+    int slot = idSlots[id];
+    xs[slot] = x;
+    ys[slot] = y;
+}
+
+void SpritePool::setFlags(int id, unsigned int flags) { flagBits[idSlots[id]] = flags; }
+int SpritePool::size() const { return count; }
+int SpritePool::capacity() const { return xs.size(); }
+int SpritePool::slotOf(int id) const { return idSlots[id]; }
+int SpritePool::idOf(int slot) const { return slotIds[slot]; }
+const double *SpritePool::x() const { return xs.data(); }
+const double *SpritePool::y() const { return ys.data(); }
+const int *SpritePool::textureId() const { return textureIds.data(); }
+const unsigned int *SpritePool::flags() const { return flagBits.data(); }
+
+void SpritePool::project(double posX, double posY, double dirX, double dirY, double camX, double camY,
+                         int screenWidth, int screenHeight, SpriteProjections &projections) const
+{
+    // inverse camera matrix, see Raycaster::castSprites
+    double invDet = 1.0 / (camX * dirY - dirX * camY);
+
+    const double *x = xs.data(), *y = ys.data();
+    const unsigned int *flags = flagBits.data();
+    double *distance = projections.distance.data(), *transformY = projections.transformY.data();
+    int *screenX = projections.screenX.data(), *size = projections.size.data();
+    int *drawStartX = projections.drawStartX.data(), *drawEndX = projections.drawEndX.data();
+    int *visible = projections.visible.data();
+
+    // The sprites are packed in the slots [0, count): the loop reads and writes contiguous arrays and is vectorized. It
+    // has no branches: the depth is floored instead of selected, which only changes the values of the sprites behind
+    // the camera (never drawn), and the values converted to int are clamped first: huge values for sprites close to
+    // the camera plane would not be representable.
+    int n = count;
+    #pragma omp simd
+    for (int i = 0; i < n; i++)
+    {
+        double spriteX = x[i] - posX;
+        double spriteY = y[i] - posY;
+        distance[i] = spriteX * spriteX + spriteY * spriteY; // sqrt not taken, unneeded
+
+        double tx = invDet * (dirY * spriteX - dirX * spriteY);
+        double ty = invDet * (-camY * spriteX + camX * spriteY);
+        transformY[i] = ty;
+
+        bool inFront = ty > 0;
+        double depth = std::max(ty, std::numeric_limits<double>::min());
+        double centerX = (screenWidth / 2) * (1 + tx / depth);
+        int center = int(std::min(std::max(centerX, -1e8), 1e8));
+        int width = int(std::min(screenHeight / depth, 1e8));
+        int start = std::max(-width / 2 + center, 0);
+        int end = std::min(width / 2 + center, screenWidth - 1);
+        screenX[i] = center;
+        size[i] = width;
+        drawStartX[i] = start;
+        drawEndX[i] = end;
+        int shown = int(flags[i] & HIDDEN) - 1; // all ones unless hidden: a bool here keeps GCC from vectorizing
+        visible[i] = int(inFront) & int(start < end) & shown;
+    }
+}
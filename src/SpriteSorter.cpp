@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <SpriteSorter.h>
+
+// Whether the sprite a is drawn before the sprite b: the farthest first, then by increasing index.
+static inline bool drawnBefore(double distanceA, int indexA, double distanceB, int indexB)
+{
+    return distanceA > distanceB || (distanceA == distanceB && indexA < indexB);
+}
+
+SpriteSorter::SpriteSorter(int capacity) : entries(capacity, Entry{0, 0, 0}),
+                                           previousOrder(capacity),
+                                           previousCount(0),
+                                           candidates(capacity),
+                                           candidateDistances(capacity),
+                                           frame(0),
+                                           keys(capacity),
+                                           keysTmp(capacity),
+                                           candidatesTmp(capacity),
+                                           candidateDistancesTmp(capacity),
+                                           pairs(std::min(capacity, int(radixThreshold)))
+{
+}
+
+const SortStats &SpriteSorter::getStats() const { return stats; }
+
+void SpriteSorter::sort(int *order, double *distance, int n)
+{
+    frame++;
+    for (int i = 0; i < n; i++)
+    {
+        entries[order[i]].present = frame;
+        entries[order[i]].distance = distance[i];
+    }
+
+    // start from the previous order of the sprites still present, followed by the new ones
+    int count = 0;
+    for (int i = 0; i < previousCount; i++)
+    {
+        int index = previousOrder[i];
+        Entry &entry = entries[index];
+        if (entry.present == frame && entry.placed != frame)
+        {
+            entry.placed = frame;
+            candidates[count] = index;
+            candidateDistances[count++] = entry.distance;
+        }
+    }
+    for (int i = 0; i < n; i++)
+        if (entries[order[i]].placed != frame)
+        {
+            entries[order[i]].placed = frame;
+            candidates[count] = order[i];
+            candidateDistances[count++] = distance[i];
+        }
+
+    if (repair(n, long(repairBudget) * n))
+        stats.repairs++;
+    else if (n >= radixThreshold)
+    {
+        radixSort(n);
+        stats.radixSorts++;
+    }
+    else
+    {
+        for (int i = 0; i < n; i++)
+            pairs[i] = {candidateDistances[i], candidates[i]};
+        std::sort(pairs.begin(), pairs.begin() + n, [](const std::pair<double, int> &a, const std::pair<double, int> &b)
+                  { return drawnBefore(a.first, a.second, b.first, b.second); });
+        for (int i = 0; i < n; i++)
+        {
+            candidateDistances[i] = pairs[i].first;
+            candidates[i] = pairs[i].second;
+        }
+        stats.comparisonSorts++;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = candidates[i];
+        distance[i] = candidateDistances[i];
+    }
+    std::swap(previousOrder, candidates);
+    previousCount = n;
+}
+
+bool SpriteSorter::repair(int n, long budget)
+{
+    int *c = candidates.data();
+    double *d = candidateDistances.data();
+    for (int i = 1; i < n; i++)
+    {
+        int index = c[i];
+        double value = d[i];
+        int j = i;
+        for (; j > 0 && drawnBefore(value, index, d[j - 1], c[j - 1]); j--)
+        {
+            c[j] = c[j - 1];
+            d[j] = d[j - 1];
+        }
+        c[j] = index;
+        d[j] = value;
+
+        budget -= i - j;
+        if (budget < 0)
+            return false;
+    }
+    return true;
+}
+
+void SpriteSorter::radixSort(int n)
+{
+    // The bits of a non-negative float compare like the float itself. The keys are complemented so that sorting them
+    // in increasing order sorts the sprites from the farthest to the nearest. Every key carries the position of its
+    // candidate in its low bits, so that the passes scatter a single array.
+    for (int i = 0; i < n; i++)
+    {
+        float value = float(candidateDistances[i]);
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        keys[i] = uint64_t(~bits) << 32 | uint32_t(i);
+    }
+
+    // three passes of 11 bits, from the least significant digit of the distance
+    const int digitBits = 11, buckets = 1 << digitBits;
+    int counts[buckets];
+    for (int shift = 32; shift < 64; shift += digitBits)
+    {
+        memset(counts, 0, sizeof(counts));
+        for (int i = 0; i < n; i++)
+            counts[(keys[i] >> shift) & (buckets - 1)]++;
+        for (int b = 0, total = 0; b < buckets; b++)
+        {
+            int count = counts[b];
+            counts[b] = total;
+            total += count;
+        }
+        for (int i = 0; i < n; i++)
+            keysTmp[counts[(keys[i] >> shift) & (buckets - 1)]++] = keys[i];
+        std::swap(keys, keysTmp);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int position = uint32_t(keys[i]);
+        candidatesTmp[i] = candidates[position];
+        candidateDistancesTmp[i] = candidateDistances[position];
+    }
+    std::swap(candidates, candidatesTmp);
+    std::swap(candidateDistances, candidateDistancesTmp);
+
+    // only the runs of distances rounding to the same float can be out of order: the insertion sort orders them by
+    // distance and index
+    repair(n, std::numeric_limits<long>::max());
+}
\ No newline at end of file
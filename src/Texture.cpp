@@ -1,27 +1,424 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
 #include <Texture.h>
 
-Texture::Texture(int width, int height, bool isVertical) : width(width), height(height), pixels(width * height), isVertical(isVertical)
+// The masks of the colors shifted right, clearing the bits shifted into the next channel.
+static unsigned int halvingMask(int shift) { return (0xFFu >> shift) * 0x010101u; }
+static unsigned short halvingMask565(int shift)
+{
+    return (0xF800 >> shift & 0xF800) | (0x07E0 >> shift & 0x07E0) | 0x001F >> shift;
+}
+
+// Darkens a color to a shade level: the stored levels scale the channels by a brightness out of 256, and every
+// shadesPerHalving levels halve them again, as the samplers do for the levels that are not stored.
+static unsigned int shadeColor(unsigned int color, int shade)
+{
+    int shift = shade / Texture::shadesPerHalving;
+    shade %= Texture::shadesPerHalving;
+    if (shade > 0)
+    {
+        unsigned int brightness = std::lround(256 * std::pow(0.5, double(shade) / Texture::shadesPerHalving));
+        unsigned int red = ((color >> 16 & 0xFF) * brightness) >> 8;
+        unsigned int green = ((color >> 8 & 0xFF) * brightness) >> 8;
+        unsigned int blue = ((color & 0xFF) * brightness) >> 8;
+        color = red << 16 | green << 8 | blue;
+    }
+    return color >> shift & halvingMask(shift);
+}
+
+Texture::Texture(int width, int height, bool isVertical)
+    : Texture(width, height, std::vector<unsigned int>(width * height).data(), isVertical)
+{
+}
+
+Texture::Texture(int width, int height, const unsigned int *pixels, bool isVertical)
+    : Texture(width, height, pixels, isVertical ? TextureLayout::COLUMN_MAJOR : TextureLayout::ROW_MAJOR)
+{
+}
+
+Texture::Texture(int width, int height, const unsigned int *pixels, TextureLayout layout) : width(width),
+                                                                                            height(height),
+                                                                                            pixels(width * height * storedShades),
+                                                                                            layout(layout),
+                                                                                            mortonX(width),
+                                                                                            mortonY(height),
+                                                                                            columnOffsets(width),
+                                                                                            rowOffsets(height),
+                                                                                            hasRGB565(false)
+{
+    buildMorton();
+    buildOffsets();
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            this->pixels[offset(x, y, layout)] = pixels[x + y * width];
+    texels = this->pixels.data();
+    buildShades();
+}
+
+Texture::Texture(int width, int height, TextureLayout layout, const unsigned int *texels, std::shared_ptr<const void> mapping)
+    : width(width),
+      height(height),
+      texels(texels),
+      mapping(mapping),
+      layout(layout),
+      mortonX(width),
+      mortonY(height),
+      columnOffsets(width),
+      rowOffsets(height),
+      hasRGB565(false)
+{
+    buildMorton();
+    buildOffsets();
+}
+
+Texture::Texture(const Texture &other)
+{
+    *this = other;
+}
+
+Texture &Texture::operator=(const Texture &other)
+{
+    width = other.width;
+    height = other.height;
+    pixels = other.pixels;
+    mapping = other.mapping;
+    // mapped pixels are shared, owned ones are the copy
+    texels = other.mapping || !other.texels ? other.texels : pixels.data();
+    layout = other.layout;
+    mortonX = other.mortonX;
+    mortonY = other.mortonY;
+    columnOffsets = other.columnOffsets;
+    rowOffsets = other.rowOffsets;
+    indexes = other.indexes;
+    palettes = other.palettes;
+    pixels565 = other.pixels565;
+    palettes565 = other.palettes565;
+    hasRGB565 = other.hasRGB565;
+    return *this;
+}
+
+void Texture::buildMorton()
+{
+    // The low bits of the coordinates are interleaved, x in the even bits and y in the odd ones. The bits of the
+    // longer side that have no counterpart come above them.
+    int bitsX = 0, bitsY = 0;
+    while ((1 << bitsX) < width)
+        bitsX++;
+    while ((1 << bitsY) < height)
+        bitsY++;
+    int interleaved = std::min(bitsX, bitsY);
+    for (int x = 0; x < width; x++)
+        for (int b = 0; b < bitsX; b++)
+            mortonX[x] |= (x >> b & 1) << (b < interleaved ? 2 * b : interleaved + b);
+    for (int y = 0; y < height; y++)
+        for (int b = 0; b < bitsY; b++)
+            mortonY[y] |= (y >> b & 1) << (b < interleaved ? 2 * b + 1 : interleaved + b);
+}
+
+void Texture::buildOffsets()
+{
+    // the bits of the columns and rows do not overlap in any layout: the position of a texel is the sum of those of
+    // its column and row
+    for (int x = 0; x < width; x++)
+        columnOffsets[x] = offset(x, 0, layout);
+    for (int y = 0; y < height; y++)
+        rowOffsets[y] = offset(0, y, layout);
+}
+
+int Texture::offset(int x, int y, TextureLayout layout) const
 {
+    switch (layout)
+    {
+    case TextureLayout::COLUMN_MAJOR:
+        return y + x * height;
+    case TextureLayout::MORTON:
+        return mortonX[x] | mortonY[y];
+    default:
+        return x + y * width;
+    }
 }
 
-Texture::Texture(int width, int height, const unsigned int *pixels, bool isVertical) : width(width), height(height), isVertical(isVertical)
+void Texture::setLayout(TextureLayout layout)
 {
-    this->pixels.resize(width * height);
-    if (isVertical)
+    // the texels of every plane (shade level or indexes) are moved from their old position to the new one
+    std::vector<int> moves(width * height);
+    for (int y = 0; y < height; y++)
         for (int x = 0; x < width; x++)
-            for (int y = 0; y < height; y++)
-                this->pixels[y + x * height] = pixels[x + y * width];
+            moves[offset(x, y, this->layout)] = offset(x, y, layout);
+    this->layout = layout;
+    buildOffsets();
+
+    // mapped pixels are copied: the texture then owns them
+    int size = width * height;
+    std::vector<unsigned int> oldPixels(texels, texels + (texels ? size * storedShades : 0));
+    pixels.resize(oldPixels.size());
+    for (int plane = 0; plane < int(pixels.size()) / size; plane++)
+        for (int i = 0; i < size; i++)
+            pixels[plane * size + moves[i]] = oldPixels[plane * size + i];
+    if (texels)
+        texels = pixels.data();
+    mapping.reset();
+    std::vector<unsigned char> oldIndexes = indexes;
+    for (int i = 0; i < int(indexes.size()); i++)
+        indexes[moves[i]] = oldIndexes[i];
+    std::vector<unsigned short> oldPixels565 = pixels565;
+    for (int plane = 0; plane < int(pixels565.size()) / size; plane++)
+        for (int i = 0; i < size; i++)
+            pixels565[plane * size + moves[i]] = oldPixels565[plane * size + i];
+}
+
+TextureLayout Texture::getLayout() const { return layout; }
+const unsigned int *Texture::getTexels() const { return texels; }
+bool Texture::isMapped() const { return mapping != NULL; }
+
+void Texture::copyPixels()
+{
+    if (!mapping)
+        return;
+    pixels.assign(texels, texels + width * height * storedShades);
+    texels = pixels.data();
+    mapping.reset();
+}
+
+Texture Texture::downsampled(int width, int height) const
+{
+    int blockWidth = this->width / width, blockHeight = this->height / height;
+    std::vector<unsigned int> reduced(width * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            unsigned int sums[3] = {0, 0, 0};
+            for (int by = 0; by < blockHeight; by++)
+                for (int bx = 0; bx < blockWidth; bx++)
+                {
+                    unsigned int color = get(x * blockWidth + bx, y * blockHeight + by);
+                    for (int c = 0; c < 3; c++)
+                        sums[c] += color >> (16 - 8 * c) & 0xFF;
+                }
+            for (int c = 0; c < 3; c++)
+                reduced[x + y * width] |= (sums[c] / (blockWidth * blockHeight)) << (16 - 8 * c);
+        }
+    return Texture(width, height, reduced.data(), layout);
+}
+
+void Texture::buildShades()
+{
+    int size = width * height;
+    for (int shade = 1; shade < storedShades; shade++)
+        for (int i = 0; i < size; i++)
+            pixels[shade * size + i] = shadeColor(pixels[i], shade);
+}
+
+void Texture::palettize()
+{
+    if (isIndexed())
+        return;
+
+    // distinct colors of the texture, with their number of pixels
+    int size = width * height;
+    std::map<unsigned int, int> counts;
+    for (int i = 0; i < size; i++)
+        counts[texels[i]]++;
+
+    // black is kept apart so that it stays exact
+    bool hasBlack = counts.count(0) > 0;
+    std::vector<std::pair<unsigned int, int>> colors;
+    for (const std::pair<const unsigned int, int> &count : counts)
+        if (count.first != 0)
+            colors.push_back(count);
+
+    std::vector<unsigned int> palette;
+    if (hasBlack)
+        palette.push_back(0);
+    int available = 256 - int(palette.size());
+    if (int(colors.size()) <= available)
+        for (const std::pair<unsigned int, int> &color : colors)
+            palette.push_back(color.first);
     else
-        for (int i = 0; i < width * height; i++)
-            this->pixels[i] = pixels[i];
+        for (unsigned int color : medianCut(colors, available))
+            palette.push_back(color);
+
+    // index of every color: the nearest color of the palette, black only for black
+    std::map<unsigned int, unsigned char> colorIndexes;
+    for (const std::pair<const unsigned int, int> &count : counts)
+    {
+        unsigned int color = count.first;
+        int best = 0;
+        long bestDistance = -1;
+        for (int j = 0; j < int(palette.size()); j++)
+        {
+            if ((palette[j] == 0) != (color == 0))
+                continue;
+            long dr = long(color >> 16 & 0xFF) - long(palette[j] >> 16 & 0xFF);
+            long dg = long(color >> 8 & 0xFF) - long(palette[j] >> 8 & 0xFF);
+            long db = long(color & 0xFF) - long(palette[j] & 0xFF);
+            long distance = dr * dr + dg * dg + db * db;
+            if (bestDistance < 0 || distance < bestDistance)
+            {
+                best = j;
+                bestDistance = distance;
+            }
+        }
+        colorIndexes[color] = best;
+    }
+
+    indexes.resize(size);
+    for (int i = 0; i < size; i++)
+        indexes[i] = colorIndexes[texels[i]];
+    palettes.assign(256 * shadeLevels, 0);
+    for (int shade = 0; shade < shadeLevels; shade++)
+        for (int j = 0; j < int(palette.size()); j++)
+            palettes[shade * 256 + j] = shadeColor(palette[j], shade);
+
+    // the full colors are not needed anymore
+    std::vector<unsigned int>().swap(pixels);
+    texels = NULL;
+    mapping.reset();
+    if (hasRGB565)
+        buildRGB565();
 }
 
-unsigned int Texture::get(int x, int y) const
+void Texture::prepareRGB565()
 {
-    x &= width - 1;
-    y &= height - 1;
-    return isVertical ? pixels[y + x * height] : pixels[x + y * width];
+    if (hasRGB565)
+        return;
+    hasRGB565 = true;
+    buildRGB565();
+}
+
+void Texture::buildRGB565()
+{
+    // only one of the pixels and the palettes is kept
+    std::vector<unsigned short>(texels ? width * height * storedShades : 0).swap(pixels565);
+    for (int i = 0; i < int(pixels565.size()); i++)
+        pixels565[i] = toRGB565(texels[i]);
+    std::vector<unsigned short>(palettes.size()).swap(palettes565);
+    for (int i = 0; i < int(palettes.size()); i++)
+        palettes565[i] = toRGB565(palettes[i]);
+}
+
+unsigned short Texture::toRGB565(unsigned int color)
+{
+    return (color >> 8 & 0xF800) | (color >> 5 & 0x07E0) | (color >> 3 & 0x001F);
+}
+
+unsigned int Texture::fromRGB565(unsigned short color)
+{
+    unsigned int red = color >> 11, green = color >> 5 & 0x3F, blue = color & 0x1F;
+    return (red << 3 | red >> 2) << 16 | (green << 2 | green >> 4) << 8 | (blue << 3 | blue >> 2);
+}
+
+std::vector<unsigned int> Texture::medianCut(std::vector<std::pair<unsigned int, int>> &colors, int size)
+{
+    auto channel = [](unsigned int color, int c)
+    { return int(color >> (16 - 8 * c) & 0xFF); };
+
+    // the boxes are ranges of the colors
+    std::vector<std::pair<int, int>> boxes = {{0, int(colors.size())}};
+    while (int(boxes.size()) < size)
+    {
+        // the box with the widest range on a channel (boxes of a single color cannot be split)
+        int widestBox = -1, widestChannel = 0, widestRange = -1;
+        for (int b = 0; b < int(boxes.size()); b++)
+            for (int c = 0; c < 3; c++)
+            {
+                int low = 255, high = 0;
+                for (int i = boxes[b].first; i < boxes[b].second; i++)
+                {
+                    low = std::min(low, channel(colors[i].first, c));
+                    high = std::max(high, channel(colors[i].first, c));
+                }
+                if (boxes[b].second - boxes[b].first > 1 && high - low > widestRange)
+                {
+                    widestBox = b;
+                    widestChannel = c;
+                    widestRange = high - low;
+                }
+            }
+        if (widestBox < 0)
+            break;
+
+        // split it at the median pixel along the channel
+        std::pair<int, int> box = boxes[widestBox];
+        std::sort(colors.begin() + box.first, colors.begin() + box.second,
+                  [&](const std::pair<unsigned int, int> &a, const std::pair<unsigned int, int> &b)
+                  { return channel(a.first, widestChannel) < channel(b.first, widestChannel); });
+        long total = 0, half = 0;
+        for (int i = box.first; i < box.second; i++)
+            total += colors[i].second;
+        int split = box.first + 1;
+        for (int i = box.first; i < box.second - 1 && half + colors[i].second <= total / 2; i++)
+        {
+            half += colors[i].second;
+            split = i + 1;
+        }
+        boxes[widestBox] = {box.first, split};
+        boxes.push_back({split, box.second});
+    }
+
+    // mean color of every box, weighted by the pixels
+    std::vector<unsigned int> palette;
+    for (const std::pair<int, int> &box : boxes)
+    {
+        long sums[3] = {0, 0, 0}, total = 0;
+        for (int i = box.first; i < box.second; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                sums[c] += long(channel(colors[i].first, c)) * colors[i].second;
+            total += colors[i].second;
+        }
+        unsigned int color = 0;
+        for (int c = 0; c < 3; c++)
+            color |= unsigned(std::lround(double(sums[c]) / total)) << (16 - 8 * c);
+        // black is reserved for the invisible color
+        palette.push_back(color == 0 ? 0x010101 : color);
+    }
+    return palette;
+}
+
+unsigned int Texture::get(int x, int y) const { return get(x, y, 0); }
+
+unsigned int Texture::get(int x, int y, int shade) const
+{
+    int i = columnOffsets[x & (width - 1)] + rowOffsets[y & (height - 1)];
+    if (!indexes.empty())
+        return palettes[shade * 256 + indexes[i]];
+    int shift = shade / storedShades;
+    return texels[shade % storedShades * width * height + i] >> shift & halvingMask(shift);
+}
+
+unsigned short Texture::get565(int x, int y, int shade) const
+{
+    int i = columnOffsets[x & (width - 1)] + rowOffsets[y & (height - 1)];
+    if (!indexes.empty())
+        return palettes565[shade * 256 + indexes[i]];
+    int shift = shade / storedShades;
+    return pixels565[shade % storedShades * width * height + i] >> shift & halvingMask565(shift);
+}
+
+void Texture::getPlane(int shade, const unsigned int *&colors, int &shift, unsigned int &mask) const
+{
+    shift = indexes.empty() ? shade / storedShades : 0;
+    mask = halvingMask(shift);
+    colors = indexes.empty() ? texels + shade % storedShades * width * height : palettes.data() + shade * 256;
+}
+
+void Texture::getPlane(int shade, const unsigned short *&colors, int &shift, unsigned short &mask) const
+{
+    shift = indexes.empty() ? shade / storedShades : 0;
+    mask = halvingMask565(shift);
+    colors = indexes.empty() ? pixels565.data() + shade % storedShades * width * height : palettes565.data() + shade * 256;
 }
 
 int Texture::getWidth() const { return width; }
-int Texture::getHeight() const { return height; }
\ No newline at end of file
+int Texture::getHeight() const { return height; }
+bool Texture::isIndexed() const { return !indexes.empty(); }
+
+size_t Texture::getMemorySize() const
+{
+    return (texels ? width * height * storedShades : 0) * sizeof(unsigned int) + indexes.size() * sizeof(unsigned char) + palettes.size() * sizeof(unsigned int) +
+           (pixels565.size() + palettes565.size()) * sizeof(unsigned short);
+}
\ No newline at end of file
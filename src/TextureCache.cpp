@@ -0,0 +1,174 @@
+#include <TextureCache.h>
+
+std::ostream &operator<<(std::ostream &os, const TextureCacheStats &stats)
+{
+    long lookups = stats.hits + stats.misses;
+    if (lookups > 0)
+        os << "Texture cache hits: " << 100.0 * stats.hits / lookups << "%" << std::endl;
+    os << "Texture cache: " << stats.loads << " loads, " << stats.evictions << " evictions, " << stats.oversized
+       << " textures larger than the budget, " << stats.residentBytes / 1024.0 << " KB resident" << std::endl;
+    return os;
+}
+
+TextureCache::TextureCache(std::shared_ptr<const AssetPack> pack, const std::vector<std::string> &names, size_t budget)
+    : pack(pack),
+      names(names),
+      budget(budget),
+      resident(names.size()),
+      lastUsed(names.size()),
+      requested(names.size()),
+      frame(0),
+      hits(0),
+      misses(0),
+      loads(0),
+      evictions(0),
+      oversized(0),
+      residentBytes(0),
+      stopping(false)
+{
+    // the placeholders are copied out of the mapping, so that looking them up never faults
+    placeholders.reserve(names.size());
+    for (int id = 0; id < int(names.size()); id++)
+    {
+        if (pack->has(placeholderName(names[id])))
+            placeholders.push_back(pack->getTexture(placeholderName(names[id])));
+        else
+            placeholders.push_back(pack->getTexture(names[id]).downsampled(placeholderSize, placeholderSize));
+        placeholders.back().copyPixels();
+        lastUsed[id] = -1;
+        requested[id] = false;
+    }
+    loader = std::thread(&TextureCache::loadRequests, this);
+}
+
+TextureCache::~TextureCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    requestAdded.notify_one();
+    loader.join();
+}
+
+const Texture &TextureCache::get(int id)
+{
+    lastUsed[id].store(frame, std::memory_order_relaxed);
+    if (resident[id])
+    {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return *resident[id];
+    }
+
+    // only the first lookup of a missing texture requests it
+    misses.fetch_add(1, std::memory_order_relaxed);
+    if (!requested[id].exchange(true))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(id);
+        }
+        requestAdded.notify_one();
+    }
+    return placeholders[id];
+}
+
+void TextureCache::update()
+{
+    std::vector<LoadedTexture> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(loaded);
+    }
+
+    // the conversions added while a texture was loading are applied now
+    for (LoadedTexture &texture : ready)
+    {
+        for (int i = texture.conversions; i < int(conversions.size()); i++)
+            conversions[i](*texture.texture);
+        // a texture that cannot fit would evict all the others and then itself: it stays requested, so that its
+        // placeholder is drawn from now on
+        if (texture.texture->getMemorySize() > budget)
+        {
+            oversized++;
+            continue;
+        }
+        residentBytes += texture.texture->getMemorySize();
+        resident[texture.id] = std::move(texture.texture);
+        requested[texture.id] = false;
+        lastUsed[texture.id] = frame;
+        loads++;
+    }
+
+    // the least recently used textures are evicted until the resident ones fit in the budget
+    while (residentBytes > budget)
+    {
+        int oldest = -1;
+        for (int id = 0; id < int(resident.size()); id++)
+            if (resident[id] && (oldest < 0 || lastUsed[id] < lastUsed[oldest]))
+                oldest = id;
+        if (oldest < 0)
+            break;
+        residentBytes -= resident[oldest]->getMemorySize();
+        resident[oldest].reset();
+        evictions++;
+    }
+    frame++;
+}
+
+void TextureCache::convert(const std::function<void(Texture &)> &conversion)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    conversions.push_back(conversion);
+    for (Texture &placeholder : placeholders)
+        conversion(placeholder);
+    residentBytes = 0;
+    for (std::unique_ptr<Texture> &texture : resident)
+        if (texture)
+        {
+            conversion(*texture);
+            residentBytes += texture->getMemorySize();
+        }
+}
+
+TextureCacheStats TextureCache::getStats() const
+{
+    TextureCacheStats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.loads = loads;
+    stats.evictions = evictions;
+    stats.oversized = oversized;
+    stats.residentBytes = residentBytes;
+    return stats;
+}
+
+std::string TextureCache::placeholderName(const std::string &name) { return name + ".low"; }
+
+void TextureCache::loadRequests()
+{
+    for (;;)
+    {
+        int id;
+        std::vector<std::function<void(Texture &)>> pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            requestAdded.wait(lock, [this]
+                              { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+            id = requests.front();
+            requests.pop_front();
+            pending = conversions;
+        }
+
+        // copying the pixels out of the mapping reads them from the disk if needed
+        std::unique_ptr<Texture> texture(new Texture(pack->getTexture(names[id])));
+        texture->copyPixels();
+        for (const std::function<void(Texture &)> &conversion : pending)
+            conversion(*texture);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back({id, std::move(texture), int(pending.size())});
+    }
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <UDPFanoutSender.h>
+
+std::ostream &operator<<(std::ostream &os, const SendStats &stats)
+{
+    if (stats.batches > 0)
+        os << "Position fan-outs: " << stats.batches << ", " << double(stats.syscalls) / stats.batches
+           << " system calls and " << 1e6 * stats.totalLatency / stats.batches << " us each (at most "
+           << 1e6 * stats.maxLatency << " us), " << stats.failures << " packets not sent" << std::endl;
+    return os;
+}
+
+UDPFanoutSender::UDPFanoutSender(const std::vector<std::pair<std::string, int>> &destinations)
+    : destinations(destinations.size()),
+      messages(destinations.size()),
+      headers(destinations.size() * PositionPacket::headerSize),
+      numbered(2 * destinations.size())
+{
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0)
+        throw std::runtime_error("Failed to create socket");
+
+    payload.iov_base = buffer;
+    payload.iov_len = 0;
+    for (size_t i = 0; i < destinations.size(); i++)
+    {
+        sockaddr_in &addr = this->destinations[i];
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(destinations[i].second);
+        addr.sin_addr.s_addr = inet_addr(destinations[i].first.c_str());
+
+        // every message sends the shared payload to its destination
+        memset(&messages[i], 0, sizeof(mmsghdr));
+        messages[i].msg_hdr.msg_name = &addr;
+        messages[i].msg_hdr.msg_namelen = sizeof(addr);
+        messages[i].msg_hdr.msg_iov = &payload;
+        messages[i].msg_hdr.msg_iovlen = 1;
+
+        // the numbered messages gather the header of their destination and the updates after the shared header
+        numbered[2 * i].iov_base = &headers[i * PositionPacket::headerSize];
+        numbered[2 * i].iov_len = PositionPacket::headerSize;
+        numbered[2 * i + 1].iov_base = buffer + PositionPacket::headerSize;
+    }
+}
+
+UDPFanoutSender::~UDPFanoutSender()
+{
+    close(sockfd);
+}
+
+void UDPFanoutSender::send(const void *data, int length)
+{
+    if (length > maxPayload)
+        throw std::invalid_argument("Payload too large");
+    memcpy(buffer, data, length);
+    sendBuffer(length, messages.data(), messages.size());
+}
+
+void UDPFanoutSender::send(const PositionPacket &packet)
+{
+    sendBuffer(packet.encode(buffer), messages.data(), messages.size());
+}
+
+void UDPFanoutSender::send(const PositionPacket &packet, const std::vector<int> &indexes)
+{
+    selected.clear();
+    for (int index : indexes)
+        selected.push_back(messages[index]);
+    sendBuffer(packet.encode(buffer), selected.data(), selected.size());
+}
+
+void UDPFanoutSender::send(const PositionPacket &packet, const std::vector<int> &indexes, std::vector<uint32_t> &sequences)
+{
+    int length = packet.encode(buffer);
+    selected.clear();
+    for (int index : indexes)
+    {
+        packet.encodeHeader(&headers[index * PositionPacket::headerSize], sequences[index]++);
+        numbered[2 * index + 1].iov_len = length - PositionPacket::headerSize;
+        selected.push_back(messages[index]);
+        selected.back().msg_hdr.msg_iov = &numbered[2 * index];
+        selected.back().msg_hdr.msg_iovlen = 2;
+    }
+    sendBuffer(length, selected.data(), selected.size());
+}
+
+void UDPFanoutSender::sendBuffer(int length, mmsghdr *batch, int count)
+{
+    auto start = std::chrono::steady_clock::now();
+    payload.iov_len = length;
+
+    // sendmmsg may send fewer messages than asked (at most UIO_MAXIOV, or until an error): the rest is submitted again,
+    // skipping a destination that fails
+    int sent = 0;
+    while (sent < count)
+    {
+        int result = sendmmsg(sockfd, batch + sent, count - sent, 0);
+        stats.syscalls++;
+        if (result < 0)
+        {
+            stats.failures++;
+            sent++;
+            continue;
+        }
+        sent += result;
+        stats.packets += result;
+    }
+
+    double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.batches++;
+    stats.totalLatency += latency;
+    stats.maxLatency = std::max(stats.maxLatency, latency);
+}
+
+int UDPFanoutSender::getDestinationCount() const { return destinations.size(); }
+const SendStats &UDPFanoutSender::getStats() const { return stats; }
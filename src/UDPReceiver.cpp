@@ -1,10 +1,16 @@
+#include <cerrno>
 #include <stdexcept>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <UDPReceiver.h>
 
-UDPReceiver::UDPReceiver(int port)
+UDPReceiver::UDPReceiver(int port) : UDPReceiver(port, 256)
+{
+}
+
+UDPReceiver::UDPReceiver(int port, int capacity) : packets(capacity), headers(capacity), vectors(capacity)
 {
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0)
@@ -15,21 +21,85 @@ UDPReceiver::UDPReceiver(int port)
     addr.sin_addr.s_addr = INADDR_ANY;
 
     if (bind(sockfd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(sockfd);
         throw std::runtime_error("Failed to bind socket");
+    }
+
+    epollfd = epoll_create1(0);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = sockfd;
+    if (epollfd < 0 || epoll_ctl(epollfd, EPOLL_CTL_ADD, sockfd, &event) < 0)
+    {
+        if (epollfd >= 0)
+            close(epollfd);
+        close(sockfd);
+        throw std::runtime_error("Failed to watch socket");
+    }
+
+    // the headers of recvmmsg point to the packets once and for all
+    for (int i = 0; i < capacity; i++)
+    {
+        vectors[i].iov_base = packets[i].data;
+        vectors[i].iov_len = sizeof(packets[i].data);
+        headers[i] = {};
+        headers[i].msg_hdr.msg_name = &packets[i].from;
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
 }
 
 UDPReceiver::~UDPReceiver()
 {
+    close(epollfd);
     close(sockfd);
 }
 
-std::pair<std::string, Vector<double>> UDPReceiver::receive()
+int UDPReceiver::receive(int timeoutMs)
 {
-    socklen_t len = sizeof(addr);
-    int read = recvfrom(sockfd, buffer, bufferSize, MSG_DONTWAIT, (sockaddr *)&addr, &len);
+    stats.waits++;
+    epoll_event event;
+    int ready = epoll_wait(epollfd, &event, 1, timeoutMs);
+    if (ready < 0 && errno != EINTR)
+        throw std::runtime_error("Failed to wait for packets");
+    if (ready <= 0)
+        return 0;
+    stats.wakeups++;
 
-    if (read != bufferSize)
-        throw std::runtime_error("Failed to receive position");
+    // drain the socket until it is empty or the ring is full
+    int count = 0, capacity = packets.size();
+    while (count < capacity)
+    {
+        for (int i = count; i < capacity; i++)
+            headers[i].msg_hdr.msg_namelen = sizeof(packets[i].from);
+        int requested = capacity - count;
+        int received = recvmmsg(sockfd, &headers[count], requested, MSG_DONTWAIT, NULL);
+        if (received <= 0)
+            break;
+        stats.batches++;
+        for (int i = count; i < count + received; i++)
+        {
+            packets[i].length = headers[i].msg_len;
+            if (headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+                stats.truncated++;
+        }
+        count += received;
+        // a short batch emptied the socket
+        if (received < requested)
+            break;
+    }
+    stats.packets += count;
+    return count;
+}
+
+const ReceivedPacket &UDPReceiver::getPacket(int i) const { return packets[i]; }
+const ReceiveStats &UDPReceiver::getStats() const { return stats; }
 
-    return {std::string(inet_ntoa(addr.sin_addr)) + std::to_string(addr.sin_port), {buffer[0], buffer[1]}};
-}
\ No newline at end of file
+int UDPReceiver::getPort() const
+{
+    sockaddr_in bound;
+    socklen_t len = sizeof(bound);
+    getsockname(sockfd, (sockaddr *)&bound, &len);
+    return ntohs(bound.sin_port);
+}
@@ -0,0 +1,46 @@
+#include <WallSegments.h>
+
+WallSegments::WallSegments(const Map &map)
+{
+    extract(map, 0);
+    extract(map, 1);
+}
+
+const std::vector<WallSegment> &WallSegments::get() const { return segments; }
+
+void WallSegments::extract(const Map &map, int side)
+{
+    // lines of constant coordinate and the extent of the map along them
+    int lines = side == 0 ? map.getWidth() : map.getHeight();
+    int length = side == 0 ? map.getHeight() : map.getWidth();
+
+    // both cells around a face must be inside the map
+    for (int coord = 1; coord < lines; coord++)
+    {
+        for (int facing = -1; facing <= 1; facing += 2)
+        {
+            int start = -1;
+            for (int i = 0; i <= length; i++)
+            {
+                bool isFace = false;
+                if (i < length)
+                {
+                    // cells on the negative and positive side of the line
+                    int x0 = side == 0 ? coord - 1 : i, y0 = side == 0 ? i : coord - 1;
+                    int x1 = side == 0 ? coord : i, y1 = side == 0 ? i : coord;
+                    bool wall0 = map.hasWall(x0, y0), wall1 = map.hasWall(x1, y1);
+                    // a face is only visible from an empty cell of the map
+                    isFace = facing > 0 ? (!wall0 && wall1) : (wall0 && !wall1);
+                }
+
+                if (isFace && start < 0)
+                    start = i;
+                else if (!isFace && start >= 0)
+                {
+                    segments.push_back({side, coord, start, i, facing});
+                    start = -1;
+                }
+            }
+        }
+    }
+}
@@ -2,15 +2,84 @@
 #include <stdexcept>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
-WindowManager::WindowManager(int width, int height) : width(width), height(height), fpsCounter(1.0)
+WindowManager::WindowManager(int width, int height) : WindowManager(width, height, false)
 {
+}
+
+// Draws the texels of the column texX of a texture, read by a sampler of its storage, every yStep pixels from pixel.
+template <typename Pixel, typename Sampler>
+static void drawTexels(Pixel *pixel, int width, int yStart, int yEnd, double texY, double step, int yStep, Sampler sampler, int texX)
+{
+    if (step < 0.5)
+    {
+        // Magnified texture: consecutive pixels share a texel. The texel is sampled once, and its run of pixels is
+        // filled until texY reaches the next texel row. texY is accumulated as in the other path, so the runs end on
+        // the same pixels.
+        for (int y = yStart; y <= yEnd;)
+        {
+            Pixel color = sampler.get(texX, int(texY));
+            double nextRow = std::floor(texY) + 1;
+            do
+            {
+                *pixel = color;
+                pixel += yStep * width;
+                texY += step;
+                y += yStep;
+            } while (y <= yEnd && texY < nextRow);
+        }
+        return;
+    }
+
+    for (int y = yStart; y <= yEnd; y += yStep)
+    {
+        *pixel = sampler.get(texX, int(texY));
+        pixel += yStep * width;
+        texY += step;
+    }
+}
+
+WindowManager::WindowManager(int width, int height, bool headless) : WindowManager(width, height, headless, FramebufferFormat::RGB888)
+{
+}
+
+WindowManager::WindowManager(int width, int height, bool headless, FramebufferFormat format) : width(width),
+                                                                                               height(height),
+                                                                                               headless(headless),
+                                                                                               format(format),
+                                                                                               imgBuffer(NULL),
+                                                                                               prevBuffer(NULL),
+                                                                                               imgBuffer16(NULL),
+                                                                                               prevBuffer16(NULL),
+                                                                                               fpsCounter(1.0)
+{
+    if (format == FramebufferFormat::RGB565)
+    {
+        imgBuffer16 = (unsigned short *)malloc(width * height * sizeof(unsigned short));
+        memset(imgBuffer16, 0, width * height * sizeof(unsigned short));
+        to888.resize(1 << 16);
+        for (int color = 0; color < 1 << 16; color++)
+            to888[color] = Texture::fromRGB565(color);
+    }
+    else
+    {
+        imgBuffer = (int *)malloc(width * height * sizeof(int));
+        memset(imgBuffer, 0, width * height * sizeof(int));
+    }
+
+    if (headless)
+    {
+        img = NULL;
+        display = NULL;
+        inputManager = NULL;
+        return;
+    }
+
     if (!(display = XOpenDisplay(NULL)))
         throw std::runtime_error("Cannot connect to X server");
 
-    imgBuffer = (int *)malloc(width * height * sizeof(int));
-    memset(imgBuffer, 0, width * height * sizeof(int));
-
     screen = DefaultScreen(display);
 
     unsigned long black = BlackPixel(display, screen);
@@ -37,15 +106,23 @@ WindowManager::WindowManager(int width, int height) : width(width), height(heigh
 
     inputManager = new InputManager(display);
 
+    // a RGB565 frame is shown as is only on a 16-bit display with the same layout, it is converted to 32 bits otherwise
     Visual *visual = DefaultVisual(display, screen);
+    bool display565 = DefaultDepth(display, screen) == 16 &&
+                      visual->red_mask == 0xF800 && visual->green_mask == 0x07E0 && visual->blue_mask == 0x001F;
+    if (format == FramebufferFormat::RGB565 && !display565)
+    {
+        imgBuffer = (int *)malloc(width * height * sizeof(int));
+        memset(imgBuffer, 0, width * height * sizeof(int));
+    }
     img = XCreateImage(display,
                        visual,
                        DefaultDepth(display, screen),
                        ZPixmap,
                        0,
-                       (char *)imgBuffer,
+                       imgBuffer ? (char *)imgBuffer : (char *)imgBuffer16,
                        width, height,
-                       32,
+                       imgBuffer ? 32 : 16,
                        0);
     if (!img)
         throw std::runtime_error("Cannot create image");
@@ -53,6 +130,15 @@ WindowManager::WindowManager(int width, int height) : width(width), height(heigh
 
 WindowManager::~WindowManager()
 {
+    free(imgBuffer);
+    free(prevBuffer);
+    free(imgBuffer16);
+    free(prevBuffer16);
+    if (headless)
+        return;
+
+    // the buffers are freed above, not by the image
+    img->data = NULL;
     XDestroyImage(img);
     XFreeGC(display, gc);
     XDestroyWindow(display, window);
@@ -63,35 +149,114 @@ WindowManager::~WindowManager()
 InputManager &WindowManager::getInputManager() { return *inputManager; }
 int WindowManager::getWidth() const { return width; }
 int WindowManager::getHeight() const { return height; }
+FramebufferFormat WindowManager::getFormat() const { return format; }
 
-void WindowManager::drawVertLine(int x, int yStart, int yEnd, int lineHeight, Texture &texture, int texX, bool darken)
+void WindowManager::drawVertLine(int x, int yStart, int yEnd, int lineHeight, const Texture &texture, int texX, int shade, int yStep)
 {
     double step = double(texture.getHeight()) / lineHeight;
     double texY = (yStart - height / 2 + lineHeight / 2) * step;
-    for (int y = yStart; y <= yEnd; y++)
-    {
-        unsigned int color = texture.get(texX, int(texY));
-        texY += step;
-        if (darken)
-            color = (color >> 1) & 8355711;
-        imgBuffer[x + y * width] = color;
-    }
+    step *= yStep;
+
+    // the format and the storage of the texture are chosen once per line, the texels are written without conversion
+    int start = x + yStart * width;
+    if (format == FramebufferFormat::RGB565 && texture.isIndexed())
+        drawTexels(imgBuffer16 + start, width, yStart, yEnd, texY, step, yStep, TextureSampler<unsigned short, true>(texture, shade), texX);
+    else if (format == FramebufferFormat::RGB565)
+        drawTexels(imgBuffer16 + start, width, yStart, yEnd, texY, step, yStep, TextureSampler<unsigned short, false>(texture, shade), texX);
+    else if (texture.isIndexed())
+        drawTexels(imgBuffer + start, width, yStart, yEnd, texY, step, yStep, TextureSampler<unsigned int, true>(texture, shade), texX);
+    else
+        drawTexels(imgBuffer + start, width, yStart, yEnd, texY, step, yStep, TextureSampler<unsigned int, false>(texture, shade), texX);
 }
 
 void WindowManager::drawPixel(int x, int y, unsigned int color)
+{
+    if (format == FramebufferFormat::RGB565)
+        imgBuffer16[x + y * width] = Texture::toRGB565(color);
+    else
+        imgBuffer[x + y * width] = color;
+}
+
+void WindowManager::drawPixel565(int x, int y, unsigned short color)
+{
+    imgBuffer16[x + y * width] = color;
+}
+
+void WindowManager::drawPixel888(int x, int y, unsigned int color)
 {
     imgBuffer[x + y * width] = color;
 }
 
+unsigned int WindowManager::getPixel(int x, int y) const
+{
+    if (format == FramebufferFormat::RGB565)
+        return to888[imgBuffer16[x + y * width]];
+    return imgBuffer[x + y * width];
+}
+
+void WindowManager::keepPreviousFrame()
+{
+    if (format == FramebufferFormat::RGB565)
+    {
+        if (prevBuffer16)
+            return;
+        prevBuffer16 = (unsigned short *)malloc(width * height * sizeof(unsigned short));
+        memcpy(prevBuffer16, imgBuffer16, width * height * sizeof(unsigned short));
+        return;
+    }
+    if (prevBuffer)
+        return;
+    prevBuffer = (int *)malloc(width * height * sizeof(int));
+    memcpy(prevBuffer, imgBuffer, width * height * sizeof(int));
+}
+
+unsigned int WindowManager::getPreviousPixel(int x, int y) const
+{
+    if (format == FramebufferFormat::RGB565)
+        return to888[prevBuffer16[x + y * width]];
+    return prevBuffer[x + y * width];
+}
+
 void WindowManager::flush()
 {
-    XPutImage(display, window, gc, img, 0, 0, 0, 0, width, height);
+    if (!headless)
+    {
+        // a RGB565 frame is converted only when the display is not RGB565
+        if (format == FramebufferFormat::RGB565 && imgBuffer)
+            for (int i = 0; i < width * height; i++)
+                imgBuffer[i] = to888[imgBuffer16[i]];
+
+        XPutImage(display, window, gc, img, 0, 0, 0, 0, width, height);
+
+        std::string fpsStr = std::to_string(int(fpsCounter.get())) + " FPS";
+        std::cout << "\r" << fpsStr << std::flush;
+    }
 
-    std::string fpsStr = std::to_string(int(fpsCounter.get())) + " FPS";
-    std::cout << "\r" << fpsStr << std::flush;
+    // the frame just shown becomes the previous one, and the next frame is drawn in the other buffer
+    if (prevBuffer16)
+    {
+        std::swap(imgBuffer16, prevBuffer16);
+        if (img && !imgBuffer)
+            img->data = (char *)imgBuffer16;
+    }
+    if (prevBuffer)
+    {
+        std::swap(imgBuffer, prevBuffer);
+        if (img)
+            img->data = (char *)imgBuffer;
+    }
 }
 
 void WindowManager::updateFPS(double fps)
 {
     fpsCounter.update(fps);
+}
+
+FramebufferFormat WindowManager::parseFramebufferFormat(const std::string &name)
+{
+    if (name == "rgb888")
+        return FramebufferFormat::RGB888;
+    if (name == "rgb565")
+        return FramebufferFormat::RGB565;
+    throw std::invalid_argument("Unknown framebuffer format: " + name);
 }
\ No newline at end of file
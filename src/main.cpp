@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <map>
@@ -5,34 +6,76 @@
 
 #include <Player.h>
 #include <Map.h>
+#include <AssetPack.h>
 #include <WindowManager.h>
 #include <Raycaster.h>
 #include <UDPReceiver.h>
-#include <UDPSender.h>
+#include <UDPFanoutSender.h>
+#include <PeerTable.h>
+#include <PlayerInterpolator.h>
+#include <PlayerSnapshots.h>
+#include <PositionReceiver.h>
+#include <SendScheduler.h>
+#include <SharedMemoryReceiver.h>
+#include <SharedMemorySender.h>
 #include <util.h>
-#include <omp.h>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <cmath>
 
 struct ProgramArguments
 {
     int screenWidth;
     int screenHeight;
-    int numThreads;
     std::string ipsPath;
+    WallEngine wallEngine;
+    int adaptiveStep;
+    RenderMode renderMode;
+    double fogDistance;
+    bool indexedTextures;
+    FramebufferFormat framebufferFormat;
+    std::string assetsPath;
+    int textureCacheSize;
+    int playerId;
+    int interpolationDelay;
+    double sendRate;
+    double minMove;
+    double minTurn;
+    int keyframeInterval;
+    bool relay;
+    int players;
+    bool sharedMemory;
 };
 
 ProgramArguments parseArgs(int argc, char *argv[])
 {
-    if (argc != 4)
+    if (argc < 4)
     {
-        std::cerr << "Usage: " << argv[0] << " <screenWidth> <screenHeight> <ipsPath> <numThreads>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <screenWidth> <screenHeight> <ipsPath> [options]" << std::endl;
         std::cerr << "  screenWidth: The width of the screen." << std::endl;
         std::cerr << "  screenHeight: The height of the screen." << std::endl;
         std::cerr << "  ipsPath: The path to the file containing the IP addresses and ports of the players." << std::endl;
-        std::cerr << "Example: " << argv[0] << " 1920 1080 ips.txt " << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --walls=<dda|segments|adaptive>: The engine used to cast the walls (default: dda)." << std::endl;
+        std::cerr << "  --adaptive-step=<n>: The distance between the columns traced first by the adaptive engine (default: 8)." << std::endl;
+        std::cerr << "  --render=<full|checkerboard|interlaced>: Which pixels are shaded in every frame, the others being reconstructed from the previous frame (default: full)." << std::endl;
+        std::cerr << "  --fog=<distance>: The distance halving the brightness of the scene (default: 0, no light falloff)." << std::endl;
+        std::cerr << "  --textures=<truecolor|indexed>: How the texels are stored, indexed textures using 8-bit palette indexes (default: truecolor)." << std::endl;
+        std::cerr << "  --framebuffer=<rgb888|rgb565>: The format of the pixels of the frames, rgb565 halving the memory traffic (default: rgb888)." << std::endl;
+        std::cerr << "  --assets=<path>: The asset pack to map the textures from, as written by the packer tool (default: the built-in textures)." << std::endl;
+        std::cerr << "  --texture-cache=<KB>: Keep at most this much memory of wall textures resident, loading them in the background from the asset pack (default: 0, all the textures kept)." << std::endl;
+        std::cerr << "  --player-id=<n>: The id of the player in the packets, unique among the players, in [0, 65535] (default: the listening port)." << std::endl;
+        std::cerr << "  --interpolation-delay=<ms>: How far in the past the other players are drawn, interpolated between the positions received (default: 100, 0 to draw the last position received)." << std::endl;
+        std::cerr << "  --send-rate=<Hz>: The most positions sent per second, the changes in between collapsing into the newest (default: 20, 0 for no limit)." << std::endl;
+        std::cerr << "  --min-move=<distance>: The smallest move worth sending at once (default: 0.01)." << std::endl;
+        std::cerr << "  --min-turn=<radians>: The smallest rotation worth sending at once (default: 0.01)." << std::endl;
+        std::cerr << "  --keyframe-interval=<ms>: The longest time without sending the position (default: 1000, 0 for no keyframes)." << std::endl;
+        std::cerr << "  --network=<mesh|relay>: Whether the positions are sent to every player of the ips file, or to the relay it lists, which sends the positions of all the players back (default: mesh)." << std::endl;
+        std::cerr << "  --players=<n>: The most other players drawn in relay mode (default: 16)." << std::endl;
+        std::cerr << "  --local-transport=<shm|udp>: Whether the players of the ips file on the loopback interface are reached through shared memory or UDP in mesh mode (default: shm)." << std::endl;
+        std::cerr << "Example: " << argv[0] << " 1920 1080 ips.txt --walls=segments" << std::endl;
         exit(1);
     }
 
@@ -40,104 +83,228 @@ ProgramArguments parseArgs(int argc, char *argv[])
     args.screenWidth = std::stoi(argv[1]);
     args.screenHeight = std::stoi(argv[2]);
     args.ipsPath =  argv[3];
-    args.numThreads = 1;
+
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 4, {"walls", "adaptive-step", "render", "fog",
+                                                                              "textures", "framebuffer", "assets",
+                                                                              "texture-cache", "player-id",
+                                                                              "interpolation-delay", "send-rate",
+                                                                              "min-move", "min-turn",
+                                                                              "keyframe-interval", "network", "players",
+                                                                              "local-transport"});
+    args.wallEngine = Raycaster::parseWallEngine(options.count("walls") ? options["walls"] : "dda");
+    args.adaptiveStep = options.count("adaptive-step") ? std::stoi(options["adaptive-step"]) : 8;
+    args.renderMode = Raycaster::parseRenderMode(options.count("render") ? options["render"] : "full");
+    args.fogDistance = options.count("fog") ? std::stod(options["fog"]) : 0;
+    std::string textures = options.count("textures") ? options["textures"] : "truecolor";
+    if (textures != "truecolor" && textures != "indexed")
+        throw std::invalid_argument("Unknown texture format: " + textures);
+    args.indexedTextures = textures == "indexed";
+    args.framebufferFormat = WindowManager::parseFramebufferFormat(options.count("framebuffer") ? options["framebuffer"] : "rgb888");
+    args.assetsPath = options.count("assets") ? options["assets"] : "";
+    args.textureCacheSize = options.count("texture-cache") ? std::stoi(options["texture-cache"]) : 0;
+    if (args.textureCacheSize > 0 && args.assetsPath.empty())
+        throw std::invalid_argument("The texture cache needs an asset pack (--assets)");
+    args.playerId = options.count("player-id") ? std::stoi(options["player-id"]) : -1;
+    if (options.count("player-id") && (args.playerId < 0 || args.playerId >= PeerTable::maxIds))
+        throw std::invalid_argument("Player id out of range: " + options["player-id"]);
+    args.interpolationDelay = options.count("interpolation-delay") ? std::stoi(options["interpolation-delay"]) : 100;
+    args.sendRate = options.count("send-rate") ? std::stod(options["send-rate"]) : 20;
+    args.minMove = options.count("min-move") ? std::stod(options["min-move"]) : 0.01;
+    args.minTurn = options.count("min-turn") ? std::stod(options["min-turn"]) : 0.01;
+    args.keyframeInterval = options.count("keyframe-interval") ? std::stoi(options["keyframe-interval"]) : 1000;
+    std::string network = options.count("network") ? options["network"] : "mesh";
+    if (network != "mesh" && network != "relay")
+        throw std::invalid_argument("Unknown network: " + network);
+    args.relay = network == "relay";
+    args.players = options.count("players") ? std::stoi(options["players"]) : 16;
+    std::string localTransport = options.count("local-transport") ? options["local-transport"] : "shm";
+    if (localTransport != "shm" && localTransport != "udp")
+        throw std::invalid_argument("Unknown local transport: " + localTransport);
+    args.sharedMemory = localTransport == "shm";
     return args;
 }
 
-void receivePlayersPositionsInParallelThread(UDPReceiver* udpReceiver,
-                                             size_t nbPlayers,
-                                             std::map<std::string, int>* playerIndexes,
-                                             Map* map,
-                                             std::atomic<bool>* isRunning) {
-    int playerIndex = 0;
-    while (isRunning->load()) {
-        for (size_t i = 0; i < nbPlayers; i++) {
-            try {
-                auto data = udpReceiver->receive();
-                if (playerIndexes->find(data.first) == playerIndexes->end()) {
-                    (*playerIndexes)[data.first] = playerIndex++;
-                    playerIndex %= nbPlayers;
-                }
-                int index = (*playerIndexes)[data.first];
-                map->movePlayer(index, data.second.x(), data.second.y());
-            } catch (...) {
-            }
-        }
+// the peer tables of the transports give out their own player indexes: the states of a snapshot are moved to the index
+// of their player on the renderer side, where the interpolator keeps the newest state received through either transport
+const std::vector<PlayerState> &mergeSnapshot(const std::vector<PlayerState> &snapshot, PeerTable &indexes,
+                                              std::vector<PlayerState> &merged) {
+    std::fill(merged.begin(), merged.end(), PlayerState());
+    for (const PlayerState &state : snapshot) {
+        int index = state.received ? indexes.getIndex(state.id) : -1;
+        if (index >= 0)
+            merged[index] = state;
     }
+    return merged;
 }
 
 std::mutex mtx;
 std::condition_variable cv;
-bool positionChanged = false;
 
-void sendPlayerPositionInParallelThread(const std::vector<std::unique_ptr<UDPSender>>* udpSenders,
-                                        const Player* player,
+void sendPlayerPositionInParallelThread(UDPFanoutSender* udpSender,
+                                        SharedMemorySender* shmSender,
+                                        int playerId,
+                                        SendScheduler* scheduler,
                                         std::atomic<bool>* isRunning) {
-    std::unique_lock<std::mutex> lock(mtx, std::defer_lock);
+    std::unique_lock<std::mutex> lock(mtx);
+    uint32_t sequence = 0;
+    // the local players follow the remote ones among the destinations of the UDP sender
+    int remoteCount = udpSender->getDestinationCount() - (shmSender ? shmSender->getDestinationCount() : 0);
+    std::vector<int> udpDestinations;
 
     while (isRunning->load()) {
-        lock.lock();
-        cv.wait(lock, []{ return positionChanged; });
+        // sleep until the scheduler has a state to send, a new state is offered, or the game stops
+        EntityUpdate state;
+        if (!scheduler->poll(PositionPacket::now(), state)) {
+            int wait = scheduler->getWait(PositionPacket::now());
+            cv.wait_for(lock, std::chrono::milliseconds(wait < 0 ? 100 : wait));
+            continue;
+        }
+        lock.unlock();
 
-        auto posX = player->posX();
-        auto posY = player->posY();
+        PositionPacket packet(playerId, sequence++, PositionPacket::now());
+        packet.add(state);
 
-        for (const auto& udpSender : *udpSenders) {
-            udpSender->send(posX, posY);
+        // one write sends the position to all the local players, and one system call to all the remote players and
+        // the local players whose segment is not open yet: those that did not start yet or use UDP
+        if (!shmSender) {
+            if (udpSender->getDestinationCount() > 0)
+                udpSender->send(packet);
+        } else {
+            shmSender->send(packet);
+            udpDestinations.clear();
+            for (int i = 0; i < udpSender->getDestinationCount(); i++)
+                if (i < remoteCount || !shmSender->isConnected(i - remoteCount))
+                    udpDestinations.push_back(i);
+            if (!udpDestinations.empty())
+                udpSender->send(packet, udpDestinations);
         }
 
-
-        positionChanged = false;
-        lock.unlock();
+        lock.lock();
     }
 }
 
 int main(int argc, char *argv[])
 {
     ProgramArguments args = parseArgs(argc, argv);
-    omp_set_num_threads(args.numThreads);
     const int screenWidth = args.screenWidth;
     const int screenHeight = args.screenHeight;
 
-    std::vector<std::unique_ptr<UDPSender>> udpSenders;
     NetworkData data = parseIPs(args.ipsPath);
     UDPReceiver udpReceiver(data.listeningPort);
-    for (auto ipPort : data.ipPorts)
-        udpSenders.push_back(std::unique_ptr<UDPSender>(new UDPSender(ipPort.first, ipPort.second)));
-    size_t nbPlayers = udpSenders.size();
-    std::map<std::string, int> playerIndexes;
+    // in mesh mode, the players of this host are reached through shared memory, the others through UDP, as well as
+    // the players of this host until their segment is open
+    std::vector<std::pair<std::string, int>> udpPlayers, localPlayers;
+    std::vector<int> localPorts;
+    for (const std::pair<std::string, int> &ipPort : data.ipPorts) {
+        if (args.sharedMemory && !args.relay && isLoopbackAddress(ipPort.first)) {
+            localPlayers.push_back(ipPort);
+            localPorts.push_back(ipPort.second);
+        } else {
+            udpPlayers.push_back(ipPort);
+        }
+    }
+    udpPlayers.insert(udpPlayers.end(), localPlayers.begin(), localPlayers.end());
+    UDPFanoutSender udpSender(udpPlayers);
+    std::unique_ptr<SharedMemorySender> shmSender;
+    std::unique_ptr<SharedMemoryReceiver> shmReceiver;
+    // through a relay, the positions of all the players come from the single destination
+    size_t nbPlayers = args.relay ? args.players : data.ipPorts.size();
+    int playerId = args.playerId >= 0 ? args.playerId : data.listeningPort;
+    PeerTable peers(nbPlayers, playerId);
+    PlayerSnapshots snapshots(nbPlayers);
+    std::unique_ptr<PeerTable> shmPeers;
+    std::unique_ptr<PlayerSnapshots> shmSnapshots;
+    if (!localPorts.empty()) {
+        std::shared_ptr<SharedMemoryRing> ring = SharedMemoryRing::create(data.listeningPort, 256);
+        shmSender.reset(new SharedMemorySender(ring, localPorts));
+        shmReceiver.reset(new SharedMemoryReceiver(ring, localPorts));
+        shmPeers.reset(new PeerTable(nbPlayers, playerId));
+        shmSnapshots.reset(new PlayerSnapshots(nbPlayers));
+    }
+    PeerTable playerIndexes(nbPlayers, playerId);
+    std::vector<PlayerState> merged(nbPlayers);
+    PlayerInterpolator interpolator(nbPlayers, args.interpolationDelay);
+    SendScheduler scheduler(args.sendRate, args.minMove, args.minTurn, args.keyframeInterval);
 
-    Map map = Map::generateMap(nbPlayers);
+    std::shared_ptr<AssetPack> pack;
+    if (!args.assetsPath.empty())
+        pack = AssetPack::open(args.assetsPath);
+    Map map = Map::generateMap(nbPlayers, pack.get());
+    // the cache is attached before the textures are converted, so that it converts the textures it loads as well
+    std::unique_ptr<TextureCache> textureCache;
+    if (args.textureCacheSize > 0)
+    {
+        textureCache.reset(new TextureCache(pack, map.getWallTextureNames(), size_t(args.textureCacheSize) * 1024));
+        map.setTextureCache(textureCache.get());
+    }
+    if (args.indexedTextures)
+        map.palettizeTextures();
     Player player({22, 11.5}, {-1, 0}, {0, 0.66}, 5, 3, map);
-    WindowManager windowManager(screenWidth, screenHeight);
+    WindowManager windowManager(screenWidth, screenHeight, false, args.framebufferFormat);
     InputManager &inputManager = windowManager.getInputManager();
     Raycaster raycaster(player, windowManager, map);
+    raycaster.setWallEngine(args.wallEngine);
+    raycaster.setAdaptiveStep(args.adaptiveStep);
+    raycaster.setRenderMode(args.renderMode);
+    raycaster.setFogDistance(args.fogDistance);
 
     std::chrono::time_point<std::chrono::system_clock> time = std::chrono::system_clock::now(), oldTime;
 
     Texture floorTexture = map.getFloorTexture();
     Texture ceilingTexture = map.getCeilingTexture();
 
+    // the initial state is offered so that the other players see the player before it moves
+    scheduler.update({playerId, player.posX(), player.posY(), std::atan2(player.dirY(), player.dirX())}, PositionPacket::now());
     std::atomic<bool> isRunning(true);
-    std::thread playerRecieveThread(receivePlayersPositionsInParallelThread,
-                              &udpReceiver,
-                              nbPlayers,
-                              &playerIndexes,
-                              &map,
-                              &isRunning);
+    // every transport has its own receiving thread, peer table and snapshots, so that the threads never wait for each
+    // other: the renderer merges the snapshots
+    PositionReceiver udpPositions(peers, snapshots, false);
+    std::unique_ptr<PositionReceiver> shmPositions;
+    std::thread playerRecieveThread(&PositionReceiver::run<UDPReceiver>,
+                                    &udpPositions,
+                                    &udpReceiver,
+                                    &isRunning);
+    std::thread localRecieveThread;
+    if (shmReceiver) {
+        shmPositions.reset(new PositionReceiver(*shmPeers, *shmSnapshots, false));
+        localRecieveThread = std::thread(&PositionReceiver::run<SharedMemoryReceiver>,
+                                         shmPositions.get(),
+                                         shmReceiver.get(),
+                                         &isRunning);
+    }
     std::thread playerSendThread(sendPlayerPositionInParallelThread,
-                                &udpSenders,
-                                &player,
+                                &udpSender,
+                                shmSender.get(),
+                                playerId,
+                                &scheduler,
                                 &isRunning);
 
    while (true)
     {
         double oldPosX = player.posX();
         double oldPosY = player.posY();
+        double oldDirX = player.dirX();
+        double oldDirY = player.dirY();
 
+        // the positions received during the previous frame are taken between two frames, and the other players are
+        // moved to where they were a moment ago
+        if (snapshots.acquire())
+            interpolator.update(mergeSnapshot(snapshots.getSnapshot(), playerIndexes, merged));
+        if (shmSnapshots && shmSnapshots->acquire())
+            interpolator.update(mergeSnapshot(shmSnapshots->getSnapshot(), playerIndexes, merged));
+        uint32_t now = PositionPacket::now();
+        for (size_t i = 0; i < nbPlayers; i++) {
+            double x, y;
+            if (interpolator.getPosition(i, now, x, y))
+                map.movePlayer(i, x, y);
+        }
+        // the textures loaded during the previous frame become resident between two frames
+        if (textureCache)
+            textureCache->update();
         raycaster.castFloorCeiling();
         raycaster.castWalls();
         raycaster.castSprites();
+        raycaster.finishFrame();
 
         oldTime = time;
         time = std::chrono::system_clock::now();
@@ -160,15 +327,33 @@ int main(int argc, char *argv[])
         if (inputManager.esc())
             break;
 
-        // Check if position has changed
-        if (player.posX() != oldPosX || player.posY() != oldPosY) {
+        // Check if position or direction has changed: the scheduler decides when the new state is sent
+        if (player.posX() != oldPosX || player.posY() != oldPosY || player.dirX() != oldDirX || player.dirY() != oldDirY) {
             std::lock_guard<std::mutex> guard(mtx);
-            positionChanged = true;
+            scheduler.update({playerId, player.posX(), player.posY(), std::atan2(player.dirY(), player.dirX())}, PositionPacket::now());
             cv.notify_one();
         }
     }
-    isRunning = false;
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        isRunning = false;
+        cv.notify_one();
+    }
     playerRecieveThread.join();
+    if (localRecieveThread.joinable())
+        localRecieveThread.join();
     playerSendThread.join();
 
+    std::cout << std::endl << raycaster.getStats();
+    if (textureCache)
+        std::cout << textureCache->getStats();
+    std::cout << scheduler.getStats(PositionPacket::now());
+    std::cout << udpSender.getStats();
+    if (shmSender)
+        std::cout << "Through shared memory: " << shmSender->getStats() << shmReceiver->getStats().dropped
+                  << " packets overwritten before they were received" << std::endl;
+    std::cout << peers.getStats();
+    if (shmPeers)
+        std::cout << "Through shared memory: " << shmPeers->getStats();
+
 }
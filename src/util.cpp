@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
+#include <arpa/inet.h>
 
 #include <util.h>
 
@@ -25,9 +28,37 @@ NetworkData parseIPs(std::string path)
      
         std::getline(f, tmp);
         int port = std::stoi(tmp);
+        // the id of the player follows its port, if it is not the port itself
+        size_t separator = tmp.find(' ');
+        int id = separator == std::string::npos ? port : std::stoi(tmp.substr(separator + 1));
      
         data.ipPorts.push_back({ip, port});
+        data.ids.push_back(id);
     }
 
     return data;
+}
+
+bool isLoopbackAddress(const std::string &ip)
+{
+    in_addr addr;
+    return inet_aton(ip.c_str(), &addr) != 0 && (ntohl(addr.s_addr) >> 24) == 127;
+}
+
+std::map<std::string, std::string> parseOptions(int argc, char *argv[], int first, const std::vector<std::string> &names)
+{
+    std::map<std::string, std::string> options;
+    for (int i = first; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t separator = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || separator == std::string::npos)
+            throw std::invalid_argument("Invalid option: " + arg);
+        std::string name = arg.substr(2, separator - 2);
+        // a misspelled option would otherwise be silently ignored
+        if (std::find(names.begin(), names.end(), name) == names.end())
+            throw std::invalid_argument("Unknown option: --" + name);
+        options[name] = arg.substr(separator + 1);
+    }
+    return options;
 }
\ No newline at end of file
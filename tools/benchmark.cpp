@@ -0,0 +1,822 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <AssetPack.h>
+#include <Map.h>
+#include <PeerTable.h>
+#include <PlayerInterpolator.h>
+#include <Player.h>
+#include <Raycaster.h>
+#include <SendScheduler.h>
+#include <SharedMemoryReceiver.h>
+#include <SharedMemorySender.h>
+#include <SpriteSorter.h>
+#include <UDPFanoutSender.h>
+#include <UDPReceiver.h>
+#include <UDPSender.h>
+#include <WindowManager.h>
+#include <textures.h>
+#include <util.h>
+
+/**
+ * Renders frames without a window and reports the time spent in every pass of the raycaster.
+ * The player turns a full circle at several positions of the default map, so that all the view angles are covered.
+ */
+
+struct PassTimes
+{
+    double floorCeiling = 0; // The total time spent casting the floor and ceiling (s).
+    double walls = 0;        // The total time spent casting the walls (s).
+    double sprites = 0;      // The total time spent casting the sprites (s).
+    double finish = 0;       // The total time spent finishing the frames (reconstruction) (s).
+    double slowestWalls = 0; // The longest time spent casting the walls of a frame (s).
+    RenderStats stats;       // The statistics accumulated over all the frames.
+    TextureCacheStats cache; // The counters of the texture cache (if any).
+};
+
+// Open positions of the default map at which the player turns around.
+const std::vector<Vector<double>> positions = {{22, 11.5}, {9.5, 9.5}, {4.5, 4.5}, {14.5, 3.5}, {19.5, 20.5}};
+
+double elapsedSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Adds sprites at random positions of the empty cells of the map (always the same ones).
+ */
+void addRandomSprites(Map &map, int n)
+{
+    srand(42);
+    while (n > 0)
+    {
+        double x = map.getWidth() * (rand() / (RAND_MAX + 1.0));
+        double y = map.getHeight() * (rand() / (RAND_MAX + 1.0));
+        if (map.hasWall(int(x), int(y)))
+            continue;
+        map.addSprite(x, y, rand() % 3);
+        n--;
+    }
+}
+
+/**
+ * @brief Renders the frames of the benchmark with the specified wall engine.
+ */
+PassTimes benchmarkRender(int width, int height, int frames, WallEngine engine, int adaptiveStep, RenderMode renderMode, int extraSprites, double fogDistance, bool indexedTextures, FramebufferFormat framebufferFormat,
+                          const std::string &assetsPath, int textureCacheSize)
+{
+    // with a texture cache, the textures of the walls are loaded from the asset pack, written first if missing
+    std::shared_ptr<AssetPack> pack;
+    if (textureCacheSize > 0)
+    {
+        if (access(assetsPath.c_str(), F_OK) != 0)
+            Map::generateMap(0).writeAssetPack(assetsPath);
+        pack = AssetPack::open(assetsPath);
+    }
+    Map map = Map::generateMap(0, pack.get());
+    std::unique_ptr<TextureCache> textureCache;
+    if (pack)
+    {
+        textureCache.reset(new TextureCache(pack, map.getWallTextureNames(), size_t(textureCacheSize) * 1024));
+        map.setTextureCache(textureCache.get());
+    }
+    if (indexedTextures)
+        map.palettizeTextures();
+    addRandomSprites(map, extraSprites);
+    WindowManager windowManager(width, height, true, framebufferFormat);
+    PassTimes times;
+
+    for (const Vector<double> &position : positions)
+    {
+        Player player(position, {-1, 0}, {0, 0.66}, 5, 3, map);
+        Raycaster raycaster(player, windowManager, map);
+        raycaster.setWallEngine(engine);
+        raycaster.setAdaptiveStep(adaptiveStep);
+        raycaster.setRenderMode(renderMode);
+        raycaster.setFogDistance(fogDistance);
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            if (textureCache)
+                textureCache->update();
+
+            auto start = std::chrono::steady_clock::now();
+            raycaster.castFloorCeiling();
+            times.floorCeiling += elapsedSince(start);
+
+            start = std::chrono::steady_clock::now();
+            raycaster.castWalls();
+            double walls = elapsedSince(start);
+            times.walls += walls;
+            times.slowestWalls = std::max(times.slowestWalls, walls);
+
+            start = std::chrono::steady_clock::now();
+            raycaster.castSprites();
+            times.sprites += elapsedSince(start);
+
+            start = std::chrono::steady_clock::now();
+            raycaster.finishFrame();
+            times.finish += elapsedSince(start);
+            windowManager.flush();
+
+            player.turn(2 * M_PI / frames / 3);
+        }
+        times.stats.columns += raycaster.getStats().columns;
+        times.stats.tracedColumns += raycaster.getStats().tracedColumns;
+        times.stats.reconstructedPixels += raycaster.getStats().reconstructedPixels;
+        times.stats.reprojectedPixels += raycaster.getStats().reprojectedPixels;
+        times.stats.sprites += raycaster.getStats().sprites;
+        times.stats.spriteCandidates += raycaster.getStats().spriteCandidates;
+        times.stats.spritesOutsideFrustum += raycaster.getStats().spritesOutsideFrustum;
+        times.stats.spritesOccluded += raycaster.getStats().spritesOccluded;
+        times.stats.spriteSorts += raycaster.getStats().spriteSorts;
+        times.stats.spriteSortRepairs += raycaster.getStats().spriteSortRepairs;
+    }
+    if (textureCache)
+        times.cache = textureCache->getStats();
+    return times;
+}
+
+/**
+ * @brief Checks that the specified wall engine sees the same walls as the DDA engine.
+ *
+ * @return true if the engine saw the same walls as the DDA in every column (up to the rounding of the distances).
+ */
+bool compareWallEngines(int width, int height, int frames, const std::string &name, int adaptiveStep)
+{
+    Map map = Map::generateMap(0);
+    WindowManager windowManager(width, height, true);
+    double maxError = 0;
+    long texXMismatches = 0, cellMismatches = 0, columns = 0;
+
+    for (const Vector<double> &position : positions)
+    {
+        Player player(position, {-1, 0}, {0, 0.66}, 5, 3, map);
+        Raycaster dda(player, windowManager, map), other(player, windowManager, map);
+        other.setWallEngine(Raycaster::parseWallEngine(name));
+        other.setAdaptiveStep(adaptiveStep);
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            dda.castWalls();
+            other.castWalls();
+            for (int x = 0; x < width; x++)
+            {
+                const WallHit &a = dda.getWallHits()[x], &b = other.getWallHits()[x];
+                maxError = std::max(maxError, std::abs(a.perpWallDist - b.perpWallDist) / a.perpWallDist);
+                texXMismatches += a.texX != b.texX;
+                cellMismatches += a.mapX != b.mapX || a.mapY != b.mapY;
+            }
+            columns += width;
+            player.turn(2 * M_PI / frames / 3);
+        }
+    }
+
+    std::cout << name << " vs dda: max relative zBuffer error " << maxError
+              << ", texX mismatches " << texXMismatches << "/" << columns
+              << ", cell mismatches " << cellMismatches << "/" << columns << std::endl;
+    return maxError < 1e-9 && texXMismatches == 0 && cellMismatches == 0;
+}
+
+/**
+ * @brief Sorts n sprites at random positions while the camera walks among them, with a sort from scratch (allocating
+ * its buffer every frame, as the raycaster used to) and with a SpriteSorter.
+ */
+void benchmarkSort(int n, int frames)
+{
+    srand(42);
+    std::vector<double> xs(n), ys(n);
+    for (int i = 0; i < n; i++)
+    {
+        xs[i] = 64 * (rand() / (RAND_MAX + 1.0));
+        ys[i] = 64 * (rand() / (RAND_MAX + 1.0));
+    }
+
+    std::vector<int> order(n);
+    std::vector<double> distance(n);
+    SpriteSorter sorter(n);
+    double fromScratch = 0, incremental = 0;
+    bool sorted = true;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // walk slowly on a circle around the center of the sprites
+        double angle = 2 * M_PI * frame / frames;
+        double posX = 32 + 16 * std::cos(angle), posY = 32 + 16 * std::sin(angle);
+        auto fill = [&]()
+        {
+            for (int i = 0; i < n; i++)
+            {
+                order[i] = i;
+                distance[i] = (posX - xs[i]) * (posX - xs[i]) + (posY - ys[i]) * (posY - ys[i]);
+            }
+        };
+
+        fill();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::pair<double, int>> sprites(n);
+        for (int i = 0; i < n; i++)
+            sprites[i] = {distance[i], order[i]};
+        std::sort(sprites.begin(), sprites.end());
+        for (int i = 0; i < n; i++)
+        {
+            distance[i] = sprites[n - i - 1].first;
+            order[i] = sprites[n - i - 1].second;
+        }
+        fromScratch += elapsedSince(start);
+
+        fill();
+        start = std::chrono::steady_clock::now();
+        sorter.sort(order.data(), distance.data(), n);
+        incremental += elapsedSince(start);
+        // farthest first, then by increasing index, whatever the strategy
+        for (int i = 1; i < n; i++)
+            sorted = sorted && (distance[i - 1] > distance[i] || (distance[i - 1] == distance[i] && order[i - 1] < order[i]));
+    }
+
+    const SortStats &stats = sorter.getStats();
+    std::cout << n << " sprites: from scratch " << 1000 * fromScratch / frames << " ms"
+              << ", incremental " << 1000 * incremental / frames << " ms (per frame)"
+              << ", repairs " << stats.repairs << ", radix sorts " << stats.radixSorts
+              << ", comparison sorts " << stats.comparisonSorts << (sorted ? "" : ", NOT SORTED") << std::endl;
+}
+
+/**
+ * @brief Reports, for every texture, the memory taken by its texels and the error of its palettized copy.
+ */
+void reportTextures()
+{
+    const std::vector<std::pair<std::string, const unsigned int *>> images = {
+        {"barrel", textures::barrel}, {"bluestone", textures::bluestone}, {"colorstone", textures::colorstone},
+        {"eagle", textures::eagle}, {"greenlight", textures::greenlight}, {"greystone", textures::greystone},
+        {"mossy", textures::mossy}, {"pillar", textures::pillar}, {"purplestone", textures::purplestone},
+        {"redbrick", textures::redbrick}, {"wood", textures::wood}};
+
+    size_t trueColorSize = 0, indexedSize = 0;
+    for (const std::pair<std::string, const unsigned int *> &image : images)
+    {
+        Texture trueColor(64, 64, image.second, false), indexed = trueColor;
+        indexed.palettize();
+
+        // error over the channels of all the pixels, at all the shade levels
+        long maxError = 0;
+        double squaredError = 0;
+        long samples = 0;
+        for (int shade = 0; shade < Texture::shadeLevels; shade++)
+            for (int y = 0; y < 64; y++)
+                for (int x = 0; x < 64; x++)
+                {
+                    unsigned int a = trueColor.get(x, y, shade), b = indexed.get(x, y, shade);
+                    for (int shift = 0; shift < 24; shift += 8)
+                    {
+                        long error = std::abs(long(a >> shift & 0xFF) - long(b >> shift & 0xFF));
+                        maxError = std::max(maxError, error);
+                        squaredError += error * error;
+                        samples++;
+                    }
+                }
+        double psnr = squaredError > 0 ? 10 * std::log10(255.0 * 255.0 * samples / squaredError) : INFINITY;
+
+        std::cout << image.first << ": " << trueColor.getMemorySize() / 1024.0 << " KB -> " << indexed.getMemorySize() / 1024.0
+                  << " KB, max channel error " << maxError << ", PSNR " << psnr << " dB" << std::endl;
+        trueColorSize += trueColor.getMemorySize();
+        indexedSize += indexed.getMemorySize();
+    }
+    std::cout << "total: " << trueColorSize / 1024.0 << " KB -> " << indexedSize / 1024.0 << " KB" << std::endl;
+}
+
+/**
+ * @brief Times the floor and ceiling pass over a full turn of the player, for every layout of their textures.
+ * The fog is passed so that the rows sample different shade levels, as in the game with the light falloff.
+ */
+void benchmarkFloor(int width, int height, int frames, double fogDistance, bool indexedTextures, FramebufferFormat framebufferFormat)
+{
+    const std::vector<std::pair<std::string, TextureLayout>> layouts = {
+        {"row-major", TextureLayout::ROW_MAJOR}, {"column-major", TextureLayout::COLUMN_MAJOR}, {"morton", TextureLayout::MORTON}};
+    const int sectors = 8;
+
+    for (const std::pair<std::string, TextureLayout> &layout : layouts)
+    {
+        Map map = Map::generateMap(0);
+        map.setTextureLayouts(TextureLayout::COLUMN_MAJOR, layout.second, TextureLayout::COLUMN_MAJOR);
+        if (indexedTextures)
+            map.palettizeTextures();
+        WindowManager windowManager(width, height, true, framebufferFormat);
+        Player player(positions[0], {-1, 0}, {0, 0.66}, 5, 3, map);
+        Raycaster raycaster(player, windowManager, map);
+        raycaster.setFogDistance(fogDistance);
+
+        // time of every sector of 45 degrees of the turn, the best of several turns to filter out the noise
+        std::vector<double> times(sectors, INFINITY);
+        for (int turn = 0; turn < 3; turn++)
+        {
+            std::vector<double> turnTimes(sectors, 0);
+            for (int frame = 0; frame < frames; frame++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                raycaster.castFloorCeiling();
+                turnTimes[frame * sectors / frames] += elapsedSince(start);
+                player.turn(2 * M_PI / frames);
+            }
+            for (int sector = 0; sector < sectors; sector++)
+                times[sector] = std::min(times[sector], turnTimes[sector]);
+        }
+
+        double total = 0, slowest = 0, fastest = INFINITY;
+        for (double time : times)
+        {
+            double perFrame = time / (frames / double(sectors));
+            total += time;
+            slowest = std::max(slowest, perFrame);
+            fastest = std::min(fastest, perFrame);
+        }
+        std::cout << layout.first << ": floor/ceiling " << 1000 * total / frames << " ms per frame, sectors of 45 degrees from "
+                  << 1000 * fastest << " to " << 1000 * slowest << " ms" << std::endl;
+    }
+}
+
+/**
+ * @brief Times the startup of the game (loading the map and its textures, constructing the raycaster and rendering the
+ * first frame) with the built-in textures, then with the textures mapped from an asset pack.
+ * The pack is written first if the file does not exist.
+ */
+void benchmarkStartup(int width, int height, int runs, const std::string &assetsPath)
+{
+    if (access(assetsPath.c_str(), F_OK) != 0)
+        Map::generateMap(0).writeAssetPack(assetsPath);
+
+    WindowManager windowManager(width, height, true);
+    for (bool packed : {false, true})
+    {
+        double load = 0, construct = 0, firstFrame = 0;
+        for (int run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<AssetPack> pack;
+            if (packed)
+                pack = AssetPack::open(assetsPath);
+            Map map = Map::generateMap(0, pack.get());
+            load += elapsedSince(start);
+
+            start = std::chrono::steady_clock::now();
+            Player player(positions[0], {-1, 0}, {0, 0.66}, 5, 3, map);
+            Raycaster raycaster(player, windowManager, map);
+            construct += elapsedSince(start);
+
+            start = std::chrono::steady_clock::now();
+            raycaster.castFloorCeiling();
+            raycaster.castWalls();
+            raycaster.castSprites();
+            firstFrame += elapsedSince(start);
+        }
+        std::cout << (packed ? "asset pack" : "built-in") << ": map " << 1000 * load / runs << " ms, raycaster "
+                  << 1000 * construct / runs << " ms, first frame " << 1000 * firstFrame / runs << " ms" << std::endl;
+    }
+}
+
+/**
+ * @brief Sends positions from many peers (one socket each) to a receiver on the loopback interface, and reports the
+ * packets received per system call and wake-up, then the CPU time the receiver takes while no packet arrives.
+ */
+void benchmarkReceive(int peers, int packetsPerPeer)
+{
+    UDPReceiver receiver(0, 256);
+    sockaddr_in destination = {};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(receiver.getPort());
+    destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // every peer sends one position per round, as in the game
+    std::thread sender([&]()
+                       {
+        std::vector<int> sockets(peers);
+        for (int &socketfd : sockets)
+            socketfd = socket(AF_INET, SOCK_DGRAM, 0);
+        unsigned char buffer[PositionPacket::maxSize];
+        for (int round = 0; round < packetsPerPeer; round++)
+        {
+            for (int peer = 0; peer < peers; peer++)
+            {
+                PositionPacket packet(peer, round, PositionPacket::now());
+                packet.add({peer, 22, 11.5, 0});
+                int length = packet.encode(buffer);
+                sendto(sockets[peer], buffer, length, 0, (sockaddr *)&destination, sizeof(destination));
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        for (int socketfd : sockets)
+            close(socketfd); });
+
+    // the packets are received and decoded until none arrives for a while
+    PeerTable table(peers, -1);
+    PositionPacket packet;
+    auto start = std::chrono::steady_clock::now();
+    double decoding = 0;
+    long received = 0;
+    for (int count; (count = receiver.receive(200)) > 0 || received == 0; received = receiver.getStats().packets)
+    {
+        auto decodeStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            if (table.accept(receiver.getPacket(i).data, receiver.getPacket(i).length, packet))
+                for (int j = 0; j < packet.getCount(); j++)
+                    table.getIndex(packet.getUpdate(j).id);
+        decoding += elapsedSince(decodeStart);
+    }
+    double elapsed = elapsedSince(start) - 0.2;
+    sender.join();
+
+    const ReceiveStats &stats = receiver.getStats();
+    std::cout << "received " << stats.packets << " of " << long(peers) * packetsPerPeer << " packets in " << 1000 * elapsed
+              << " ms: " << double(stats.packets) / stats.batches << " packets per recvmmsg, "
+              << double(stats.packets) / stats.wakeups << " packets per wake-up, " << 1e9 * decoding / stats.packets
+              << " ns to decode a packet" << std::endl;
+    std::cout << table.getStats();
+
+    // an idle receiver sleeps in epoll
+    std::clock_t cpuStart = std::clock();
+    start = std::chrono::steady_clock::now();
+    while (elapsedSince(start) < 0.5)
+        receiver.receive(100);
+    std::cout << "idle: " << 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC << " ms of CPU over 500 ms" << std::endl;
+}
+
+/**
+ * @brief Sends positions to many peers on the loopback interface, with one UDPSender (socket and sendto) per peer,
+ * then with a single UDPFanoutSender, and reports the system calls and the time of a fan-out.
+ */
+void benchmarkSend(int peers, int rounds)
+{
+    // the peers are sockets that never read: the datagrams are dropped once their buffers are full
+    std::vector<std::pair<std::string, int>> destinations;
+    std::vector<int> sockets(peers);
+    for (int &socketfd : sockets)
+    {
+        socketfd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bind(socketfd, (sockaddr *)&addr, sizeof(addr));
+        getsockname(socketfd, (sockaddr *)&addr, &len);
+        destinations.push_back({"127.0.0.1", ntohs(addr.sin_port)});
+    }
+
+    std::vector<std::unique_ptr<UDPSender>> senders;
+    for (const std::pair<std::string, int> &destination : destinations)
+        senders.push_back(std::unique_ptr<UDPSender>(new UDPSender(destination.first, destination.second)));
+    double total = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const std::unique_ptr<UDPSender> &sender : senders)
+            sender->send(round, round);
+        total += elapsedSince(start);
+    }
+    std::cout << "sendto per peer: " << peers << " system calls and " << 1e6 * total / rounds << " us per fan-out" << std::endl;
+
+    UDPFanoutSender fanout(destinations);
+    for (int round = 0; round < rounds; round++)
+    {
+        PositionPacket packet(0, round, PositionPacket::now());
+        packet.add({0, double(round), double(round), 0});
+        fanout.send(packet);
+    }
+    const SendStats &stats = fanout.getStats();
+    std::cout << "sendmmsg: " << double(stats.syscalls) / stats.batches << " system calls and "
+              << 1e6 * stats.totalLatency / stats.batches << " us per fan-out (at most " << 1e6 * stats.maxLatency << " us)"
+              << std::endl;
+
+    for (int socketfd : sockets)
+        close(socketfd);
+}
+
+/**
+ * @brief Sends timestamped packets from a sender to receivers, each in its own thread, and reports the time and system
+ * calls of a fan-out, the latency from the send to the receive, and the CPU time the receivers take per packet.
+ *
+ * @param interval The time between two fan-outs (us), 0 to send them back to back.
+ */
+template <typename Sender, typename Receiver>
+void benchmarkTransport(const std::string &name, Sender &sender, std::vector<std::unique_ptr<Receiver>> &receivers, int rounds, int interval)
+{
+    std::vector<std::vector<double>> latencies(receivers.size());
+    std::vector<double> cpuTimes(receivers.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < receivers.size(); i++)
+        threads.push_back(std::thread([&, i]()
+                                      {
+            // the packets are received until all arrived or none arrives for a while
+            Receiver &receiver = *receivers[i];
+            for (int count; latencies[i].size() < size_t(rounds) && (count = receiver.receive(200)) > 0;)
+                for (int j = 0; j < count; j++)
+                {
+                    int64_t sent;
+                    memcpy(&sent, receiver.getPacket(j).data, sizeof(sent));
+                    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                    latencies[i].push_back((now - sent) / 1000.0);
+                }
+            timespec cpu;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+            cpuTimes[i] = cpu.tv_sec + cpu.tv_nsec / 1e9; }));
+
+    // the receivers start sleeping before the first packet
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    unsigned char buffer[24] = {};
+    for (int round = 0; round < rounds; round++)
+    {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        memcpy(buffer, &now, sizeof(now));
+        sender.send(buffer, sizeof(buffer));
+        if (interval > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(interval));
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    std::vector<double> all;
+    double cpu = 0;
+    for (size_t i = 0; i < receivers.size(); i++)
+    {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        cpu += cpuTimes[i];
+    }
+    std::sort(all.begin(), all.end());
+    const SendStats &stats = sender.getStats();
+    std::cout << name << (interval > 0 ? ", " + std::to_string(interval) + " us apart: " : ", back to back: ") << 1e6 * stats.totalLatency / stats.batches << " us and " << double(stats.syscalls) / stats.batches
+              << " system calls per fan-out, received " << all.size() << " of " << long(rounds) * receivers.size()
+              << " packets, latency " << (all.empty() ? 0 : all[all.size() / 2]) << " us (99th percentile: "
+              << (all.empty() ? 0 : all[all.size() * 99 / 100]) << " us), " << 1e6 * cpu / std::max<size_t>(all.size(), 1)
+              << " us of receiver CPU per packet" << std::endl;
+}
+
+/**
+ * @brief Compares the transports between the players of a host: loopback UDP (one sendmmsg per fan-out and a socket
+ * per receiver) and the shared memory rings (one write per fan-out and a futex per receiver).
+ */
+void benchmarkTransports(int peers, int rounds)
+{
+    // the sockets of the receivers give the ports naming the shared memory segments as well
+    UDPReceiver senderSocket(0, 1);
+    std::vector<std::unique_ptr<UDPReceiver>> udpReceivers;
+    std::vector<std::pair<std::string, int>> destinations;
+    std::vector<int> ports;
+    for (int i = 0; i < peers; i++)
+    {
+        udpReceivers.push_back(std::unique_ptr<UDPReceiver>(new UDPReceiver(0, 256)));
+        destinations.push_back({"127.0.0.1", udpReceivers.back()->getPort()});
+        ports.push_back(udpReceivers.back()->getPort());
+    }
+    std::vector<std::unique_ptr<SharedMemoryReceiver>> shmReceivers;
+    for (int port : ports)
+        shmReceivers.push_back(std::unique_ptr<SharedMemoryReceiver>(new SharedMemoryReceiver(SharedMemoryRing::create(port, 1), {senderSocket.getPort()})));
+
+    // as in the game, where the receivers sleep between two positions, then with the receivers kept busy
+    for (int interval : {1000, 0})
+    {
+        UDPFanoutSender udpSender(destinations);
+        benchmarkTransport("loopback UDP", udpSender, udpReceivers, rounds, interval);
+        SharedMemorySender shmSender(SharedMemoryRing::create(senderSocket.getPort(), 256), ports);
+        benchmarkTransport("shared memory", shmSender, shmReceivers, rounds, interval);
+    }
+}
+
+/**
+ * @brief Simulates a remote player walking in a circle, sending its position at several rates over a network with a
+ * jittery latency, and drawn at 60 frames per second at the last position received and interpolated. Reports the
+ * bandwidth, the error from the path of the player, and the stutter (how much the distance moved per frame varies).
+ */
+void benchmarkInterpolation(int frames, int delay)
+{
+    const double speed = 5, radius = 4, frameTime = 1000.0 / 60;
+    const uint32_t senderClock = 4000000000u; // the clock of the sender is far from the local one, across the wrap-around
+    auto path = [&](double t, double &x, double &y)
+    {
+        x = 12 + radius * std::cos(speed * t / 1000 / radius);
+        y = 12 + radius * std::sin(speed * t / 1000 / radius);
+    };
+
+    for (int rate : {60, 20, 10})
+    {
+        // the states arrive 20 to 35 ms after being sent, possibly out of order
+        srand(42);
+        std::vector<PlayerState> sent;
+        for (double t = 0; t < frames * frameTime; t += 1000.0 / rate)
+        {
+            PlayerState state;
+            path(t, state.x, state.y);
+            state.timestamp = senderClock + uint32_t(t);
+            state.arrival = uint32_t(t + 20 + 15 * (rand() / (RAND_MAX + 1.0)));
+            state.received = true;
+            sent.push_back(state);
+        }
+        std::stable_sort(sent.begin(), sent.end(), [](const PlayerState &a, const PlayerState &b)
+                         { return a.arrival < b.arrival; });
+
+        for (int drawDelay : {0, delay})
+        {
+            PlayerInterpolator interpolator(1, drawDelay);
+            std::vector<PlayerState> snapshot(1);
+            size_t next = 0;
+            double previousX = 0, previousY = 0, error = 0, stutter = 0;
+            int drawn = 0, steps = 0;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                double now = frame * frameTime;
+                for (; next < sent.size() && sent[next].arrival <= now; next++)
+                    if (!snapshot[0].received || int32_t(sent[next].timestamp - snapshot[0].timestamp) > 0)
+                        snapshot[0] = sent[next];
+                interpolator.update(snapshot);
+                double x, y, pathX, pathY;
+                if (!interpolator.getPosition(0, uint32_t(now), x, y))
+                    continue;
+
+                // the error is measured from where the player was, the fastest trip and the delay ago
+                path(now - 20 - drawDelay, pathX, pathY);
+                error += std::hypot(x - pathX, y - pathY);
+                if (drawn++ > 0)
+                {
+                    double step = std::hypot(x - previousX, y - previousY) - speed * frameTime / 1000;
+                    stutter += step * step;
+                    steps++;
+                }
+                previousX = x;
+                previousY = y;
+            }
+            std::cout << rate << " Hz (" << rate * (PositionPacket::headerSize + PositionPacket::updateSize + 28) * 8 / 1000.0
+                      << " kbit/s per peer), " << (drawDelay > 0 ? "interpolated " + std::to_string(drawDelay) + " ms ago" : "last received")
+                      << ": error " << error / drawn << ", stutter " << std::sqrt(stutter / steps) << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Simulates a player at 500 frames per second walking, turning, then standing still, and reports the states
+ * sent by the send scheduler with several settings, against sending every change.
+ */
+void benchmarkGovernor(int frames)
+{
+    struct Settings
+    {
+        const char *name;
+        double maxRate, minMove, minTurn;
+        int keyframeInterval;
+    };
+    const Settings settings[] = {{"every change", 0, 0, 0, 0},
+                                 {"60 Hz", 60, 0, 0, 0},
+                                 {"20 Hz", 20, 0, 0, 0},
+                                 {"20 Hz, thresholds, 1 s keyframes", 20, 0.01, 0.01, 1000}};
+    for (const Settings &setting : settings)
+    {
+        SendScheduler scheduler(setting.maxRate, setting.minMove, setting.minTurn, setting.keyframeInterval);
+        EntityUpdate state = {0, 22, 11.5, 0}, sent;
+        double time = 0;
+        for (int frame = 0; frame < frames; frame++, time += 2)
+        {
+            // a 5 s cycle: walking for 2 s, turning for 1 s, standing still for 2 s
+            double phase = std::fmod(time, 5000);
+            if (phase < 2000)
+            {
+                state.x += 5 * 0.002 * std::cos(state.direction);
+                state.y += 5 * 0.002 * std::sin(state.direction);
+            }
+            else if (phase < 3000)
+                state.direction += 3 * 0.002;
+            if (phase < 3000 || frame == 0)
+                scheduler.update(state, uint32_t(time));
+            while (scheduler.poll(uint32_t(time), sent))
+                ;
+        }
+        SendSchedulerStats stats = scheduler.getStats(uint32_t(time));
+        std::cout << setting.name << ": " << stats.changes / stats.seconds << " changes/s, " << stats.sent / stats.seconds
+                  << " packets/s sent (" << stats.keyframes << " keyframes)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <screenWidth> <screenHeight> <frames> [options]" << std::endl;
+        std::cerr << "  frames: The number of frames rendered for a full turn, at each position." << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --walls=<dda|segments|adaptive|all>: The wall engines to benchmark (default: all)." << std::endl;
+        std::cerr << "  --adaptive-step=<n>: The distance between the columns traced first by the adaptive engine (default: 8)." << std::endl;
+        std::cerr << "  --render=<full|checkerboard|interlaced>: Which pixels are shaded in every frame (default: full)." << std::endl;
+        std::cerr << "  --sprites=<n>: The number of sprites added at random positions of the map (default: 0)." << std::endl;
+        std::cerr << "  --fog=<distance>: The distance halving the brightness of the scene (default: 0, no light falloff)." << std::endl;
+        std::cerr << "  --textures=<truecolor|indexed>: How the texels are stored (default: truecolor)." << std::endl;
+        std::cerr << "  --framebuffer=<rgb888|rgb565>: The format of the pixels of the frames (default: rgb888)." << std::endl;
+        std::cerr << "  --suite=<render|sort|textures|floor|startup|receive|send|interpolation|governor|transport>: Benchmark the render passes, the sprite sort alone with 10, 1k and 100k sprites, report the memory and quality of the indexed textures, benchmark the floor and ceiling over a full turn for every texture layout, time the startup with the built-in textures and with an asset pack (frames being the number of runs), benchmark the receiver of the positions (frames being the number of positions sent by every peer), the senders of the positions (frames being the number of fan-outs), the drawing of a remote player at several send rates (frames being the number of frames drawn), the send scheduler at 500 frames per second (frames being the number of frames), or the transports between the players of a host (frames being the number of fan-outs) (default: render)." << std::endl;
+        std::cerr << "  --interpolation-delay=<ms>: How far in the past the remote player is drawn in the interpolation suite (default: 100)." << std::endl;
+        std::cerr << "  --peers=<n>: The number of peers in the receive, send and transport suites (default: 256)." << std::endl;
+        std::cerr << "  --assets=<path>: The asset pack of the startup suite and of the texture cache, written if it does not exist (default: assets.pack)." << std::endl;
+        std::cerr << "  --texture-cache=<KB>: Serve the textures of the walls from a texture cache of this size, loading them from the asset pack (default: 0, no cache)." << std::endl;
+        std::cerr << "Example: " << argv[0] << " 1920 1080 360 --walls=all" << std::endl;
+        return 1;
+    }
+
+    int width = std::stoi(argv[1]);
+    int height = std::stoi(argv[2]);
+    int frames = std::stoi(argv[3]);
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 4, {"walls", "adaptive-step", "render",
+                                                                              "sprites", "fog", "textures",
+                                                                              "framebuffer", "suite", "assets",
+                                                                              "texture-cache", "peers",
+                                                                              "interpolation-delay"});
+    std::string walls = options.count("walls") ? options["walls"] : "all";
+    int adaptiveStep = options.count("adaptive-step") ? std::stoi(options["adaptive-step"]) : 8;
+    RenderMode renderMode = Raycaster::parseRenderMode(options.count("render") ? options["render"] : "full");
+    int extraSprites = options.count("sprites") ? std::stoi(options["sprites"]) : 0;
+    double fogDistance = options.count("fog") ? std::stod(options["fog"]) : 0;
+    std::string textures = options.count("textures") ? options["textures"] : "truecolor";
+    if (textures != "truecolor" && textures != "indexed")
+        throw std::invalid_argument("Unknown texture format: " + textures);
+    bool indexedTextures = textures == "indexed";
+    FramebufferFormat framebufferFormat = WindowManager::parseFramebufferFormat(options.count("framebuffer") ? options["framebuffer"] : "rgb888");
+    std::string suite = options.count("suite") ? options["suite"] : "render";
+    std::string assetsPath = options.count("assets") ? options["assets"] : "assets.pack";
+    int textureCacheSize = options.count("texture-cache") ? std::stoi(options["texture-cache"]) : 0;
+
+    if (suite == "sort")
+    {
+        for (int n : {10, 1000, 100000})
+            benchmarkSort(n, frames);
+        return 0;
+    }
+    if (suite == "floor")
+    {
+        benchmarkFloor(width, height, frames, fogDistance, indexedTextures, framebufferFormat);
+        return 0;
+    }
+    if (suite == "receive")
+    {
+        benchmarkReceive(options.count("peers") ? std::stoi(options["peers"]) : 256, frames);
+        return 0;
+    }
+    if (suite == "send")
+    {
+        benchmarkSend(options.count("peers") ? std::stoi(options["peers"]) : 256, frames);
+        return 0;
+    }
+    if (suite == "transport")
+    {
+        benchmarkTransports(options.count("peers") ? std::stoi(options["peers"]) : 256, frames);
+        return 0;
+    }
+    if (suite == "interpolation")
+    {
+        benchmarkInterpolation(frames, options.count("interpolation-delay") ? std::stoi(options["interpolation-delay"]) : 100);
+        return 0;
+    }
+    if (suite == "governor")
+    {
+        benchmarkGovernor(frames);
+        return 0;
+    }
+    if (suite == "startup")
+    {
+        benchmarkStartup(width, height, frames, assetsPath);
+        return 0;
+    }
+    if (suite == "textures")
+    {
+        reportTextures();
+        return 0;
+    }
+    if (suite != "render")
+        throw std::invalid_argument("Invalid benchmark suite: " + suite);
+
+    std::vector<std::string> engines = walls == "all" ? std::vector<std::string>{"dda", "segments", "adaptive"} : std::vector<std::string>{walls};
+    int totalFrames = frames * positions.size();
+    for (const std::string &engine : engines)
+    {
+        PassTimes times = benchmarkRender(width, height, frames, Raycaster::parseWallEngine(engine), adaptiveStep, renderMode, extraSprites, fogDistance, indexedTextures, framebufferFormat, assetsPath, textureCacheSize);
+        std::cout << engine << ": floor/ceiling " << 1000 * times.floorCeiling / totalFrames << " ms"
+                  << ", walls " << 1000 * times.walls / totalFrames << " ms"
+                  << ", sprites " << 1000 * times.sprites / totalFrames << " ms"
+                  << ", finish " << 1000 * times.finish / totalFrames << " ms (per frame)"
+                  << ", slowest walls " << 1000 * times.slowestWalls << " ms" << std::endl
+                  << times.stats;
+        if (textureCacheSize > 0)
+            std::cout << times.cache;
+    }
+
+    // a wall engine seeing other walls than the DDA fails the benchmark
+    bool same = true;
+    for (const std::string &engine : engines)
+        if (engine != "dda")
+            same = compareWallEngines(width, height, frames, engine, adaptiveStep) && same;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#include <iostream>
+
+#include <AssetPack.h>
+#include <Map.h>
+
+/**
+ * Writes the textures of the generated map to an asset pack, converted as the game uses them (layouts and shade
+ * levels), so that the game can map them at startup instead of converting the built-in textures.
+ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <packPath>" << std::endl;
+        std::cerr << "  packPath: The path to the asset pack to write." << std::endl;
+        std::cerr << "Example: " << argv[0] << " assets.pack" << std::endl;
+        return 1;
+    }
+
+    Map::generateMap(0).writeAssetPack(argv[1]);
+    std::shared_ptr<AssetPack> pack = AssetPack::open(argv[1]);
+    std::cout << argv[1] << ": " << pack->getSize() / 1024.0 << " KB" << std::endl;
+    return 0;
+}
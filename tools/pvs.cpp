@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <Map.h>
+#include <PotentiallyVisibleSet.h>
+#include <util.h>
+
+/**
+ * Precomputes the potentially visible set of the map, written alongside it for the relay (see relay --pvs), and
+ * reports the share of the position updates the relay still forwards with it.
+ */
+
+/**
+ * @brief Generates the walls of a large map made of square rooms, with doors at random positions between them.
+ *
+ * @param size The width and height of the map, in tiles.
+ * @param room The width and height of the rooms, walls included, in tiles.
+ * @return Whether every tile is a wall, row by row.
+ */
+std::vector<bool> generateRooms(int size, int room)
+{
+    srand(42);
+    std::vector<bool> walls(size_t(size) * size, false);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            walls[x + y * size] = x % room == 0 || y % room == 0 || x == size - 1 || y == size - 1;
+
+    // most walls between two rooms have a door two tiles wide
+    for (int y = 0; y + room < size; y += room)
+        for (int x = 0; x + room < size; x += room)
+        {
+            if (rand() % 4 != 0)
+            {
+                int door = y + 1 + rand() % (room - 3);
+                walls[x + room + door * size] = walls[x + room + (door + 1) * size] = false;
+            }
+            if (rand() % 4 != 0)
+            {
+                int door = x + 1 + rand() % (room - 3);
+                walls[door + (y + room) * size] = walls[door + 1 + (y + room) * size] = false;
+            }
+        }
+    return walls;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <pvsPath> [options]" << std::endl;
+        std::cerr << "  pvsPath: The path to the potentially visible set to write." << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --cell=<n>: The width and height of the cells, in tiles (default: 2)." << std::endl;
+        std::cerr << "  --size=<n>: Compute the set of a generated map of this size made of rooms, instead of the map of the game (default: 0)." << std::endl;
+        std::cerr << "  --rate=<Hz>: The rate of the updates of the players, to compare with the background snapshots of the relay (default: 20)." << std::endl;
+        std::cerr << "  --background=<ms>: The time between two background snapshots of the relay (default: 1000)." << std::endl;
+        std::cerr << "Example: " << argv[0] << " map.pvs" << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 2, {"cell", "size", "rate", "background"});
+    int cellSize = options.count("cell") ? std::stoi(options["cell"]) : 2;
+    int size = options.count("size") ? std::stoi(options["size"]) : 0;
+    double rate = options.count("rate") ? std::stod(options["rate"]) : 20;
+    double background = options.count("background") ? std::stod(options["background"]) : 1000;
+
+    int width, height;
+    std::vector<bool> walls;
+    if (size > 0)
+    {
+        width = height = size;
+        walls = generateRooms(size, 8);
+    }
+    else
+    {
+        Map map = Map::generateMap(0);
+        width = map.getWidth();
+        height = map.getHeight();
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                walls.push_back(map.hasWall(x, y));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PotentiallyVisibleSet pvs(walls, width, height, cellSize);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pvs.save(argv[1]);
+
+    // the players are spread uniformly over the empty tiles: an update is forwarded if the two players can see each other
+    std::vector<int> cells;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            if (!walls[x + y * width])
+                cells.push_back(pvs.getCell(x + 0.5, y + 0.5));
+    srand(1);
+    long visible = 0, pairs = 1000000;
+    for (long i = 0; i < pairs; i++)
+        visible += pvs.isVisible(cells[rand() % cells.size()], cells[rand() % cells.size()]);
+    double forwarded = double(visible) / pairs;
+    double withBackground = forwarded + (1 - forwarded) * 1000 / background / rate;
+
+    std::cout << argv[1] << ": " << width << "x" << height << " tiles, " << pvs.getCellCount() << " cells of "
+              << cellSize << "x" << cellSize << ", computed in " << elapsed << " s" << std::endl;
+    std::cout << "Visible pairs of cells: " << 100 * pvs.getVisibleFraction() << "%" << std::endl;
+    std::cout << "Updates forwarded between players spread over the map: " << 100 * forwarded << "%, "
+              << 100 * withBackground << "% with a background snapshot every " << background << " ms for " << rate
+              << " Hz updates (" << 100 * (1 - withBackground) << "% of the bandwidth saved)" << std::endl;
+    return 0;
+}
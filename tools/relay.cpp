@@ -0,0 +1,53 @@
+#include <iostream>
+#include <memory>
+
+#include <PositionRelay.h>
+#include <util.h>
+
+/**
+ * Relays the positions of the players: the players started with --network=relay send their updates to the relay only,
+ * and the relay sends the updates of every tick to all of them in combined packets.
+ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ipsPath> [options]" << std::endl;
+        std::cerr << "  ipsPath: The path to the file containing the port of the relay, then the IP addresses, ports and ids of the players." << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --tick=<ms>: The time between two snapshots sent to the players (default: 10)." << std::endl;
+        std::cerr << "  --relay-id=<n>: The id of the relay in the packets, different from the ids of the players (default: the port of the relay)." << std::endl;
+        std::cerr << "  --pvs=<path>: Forward the updates of a player only to the players who can possibly see it, as written by the pvs tool (default: all the updates to all the players)." << std::endl;
+        std::cerr << "  --background=<ms>: The time between two snapshots of all the players sent to all the players with --pvs (default: 1000)." << std::endl;
+        std::cerr << "  --report=<s>: The time between two reports of the traffic (default: 5)." << std::endl;
+        std::cerr << "Example: " << argv[0] << " relay.txt --tick=20" << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 2, {"tick", "relay-id", "report", "pvs",
+                                                                              "background"});
+    NetworkData data = parseIPs(argv[1]);
+    int tick = options.count("tick") ? std::stoi(options["tick"]) : 10;
+    int id = options.count("relay-id") ? std::stoi(options["relay-id"]) : data.listeningPort;
+    double report = options.count("report") ? std::stod(options["report"]) : 5;
+
+    PositionRelay relay(data.listeningPort, data.ipPorts, id, tick);
+    std::unique_ptr<PotentiallyVisibleSet> pvs;
+    if (options.count("pvs"))
+    {
+        pvs.reset(new PotentiallyVisibleSet(PotentiallyVisibleSet::load(options["pvs"])));
+        relay.setInterestManagement(pvs.get(), data.ids, options.count("background") ? std::stoi(options["background"]) : 1000);
+    }
+    std::cout << "Relaying the positions of " << data.ipPorts.size() << " players on port " << relay.getPort() << std::endl;
+    for (double nextReport = report;;)
+    {
+        relay.update();
+        RelayStats stats = relay.getStats();
+        if (stats.seconds >= nextReport)
+        {
+            std::cout << stats;
+            nextReport += report;
+        }
+    }
+}
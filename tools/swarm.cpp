@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+#include <Map.h>
+#include <PeerTable.h>
+#include <Player.h>
+#include <PlayerSnapshots.h>
+#include <PositionReceiver.h>
+#include <SendScheduler.h>
+#include <UDPFanoutSender.h>
+#include <UDPReceiver.h>
+#include <util.h>
+
+/**
+ * Runs many headless players (bots) in one process to load the network: the bots walk the map of the game with the
+ * movement of the player, send their positions with the send scheduler and the packets of the game, and the receiving
+ * thread of the game (a PositionReceiver) takes in the positions sent to the swarm. The traffic, the latency of the
+ * positions received and the packets lost are reported regularly, with the load of the receiving thread.
+ */
+
+/**
+ * @brief A step of the path of a bot: what it does, and for how long.
+ */
+struct PathStep
+{
+    int move;       // 1 to walk forward, -1 backward, 0 to stand.
+    int turn;       // 1 to turn left, -1 right, 0 to keep the direction.
+    double seconds; // The duration of the step.
+};
+
+/**
+ * @brief A simulated player.
+ */
+struct Bot
+{
+    Player player;           // The position and direction of the bot, moved as the player of the game.
+    SendScheduler scheduler; // When the positions of the bot are sent.
+    int id;                  // The id of the bot in the packets.
+    uint32_t sequence;       // The sequence number of the next packet of the bot.
+    size_t step;             // The index of the step of the path (scripted paths only).
+    PathStep current;        // The step being walked.
+    double remaining;        // The time left in the step (s).
+};
+
+/**
+ * @brief Gets the counters of the receiving thread between two reads.
+ *
+ * @param now The counters read last.
+ * @param before The counters read before.
+ * @return The differences of the counters.
+ */
+PositionReceiveStats subtractStats(const PositionReceiveStats &now, const PositionReceiveStats &before)
+{
+    PositionReceiveStats stats = now;
+    stats.packets -= before.packets;
+    stats.updates -= before.updates;
+    stats.lost -= before.lost;
+    for (size_t latency = 0; latency < stats.latencies.size(); latency++)
+        stats.latencies[latency] -= before.latencies[latency];
+    return stats;
+}
+
+/**
+ * @brief Reads a scripted path: a step per line, an action (forward, backward, left, right or wait) and a duration in
+ * seconds.
+ *
+ * @param path The path to the file.
+ * @return The steps.
+ */
+std::vector<PathStep> readPath(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Failed to open path: " + path);
+    std::vector<PathStep> steps;
+    std::string action;
+    double seconds;
+    while (file >> action >> seconds)
+    {
+        if (action == "forward")
+            steps.push_back({1, 0, seconds});
+        else if (action == "backward")
+            steps.push_back({-1, 0, seconds});
+        else if (action == "left")
+            steps.push_back({0, 1, seconds});
+        else if (action == "right")
+            steps.push_back({0, -1, seconds});
+        else if (action == "wait")
+            steps.push_back({0, 0, seconds});
+        else
+            throw std::invalid_argument("Unknown path action: " + action);
+    }
+    if (steps.empty())
+        throw std::invalid_argument("Empty path: " + path);
+    return steps;
+}
+
+/**
+ * @brief Draws a random step: mostly walking forward, sometimes turning, backing or standing, for 0.2 to 2 seconds.
+ *
+ * @return The step.
+ */
+PathStep randomStep()
+{
+    static const int moves[] = {1, 1, 1, 0, -1};
+    return {moves[rand() % 5], rand() % 3 - 1, 0.2 + 1.8 * rand() / RAND_MAX};
+}
+
+/**
+ * @brief Gets a latency from the counters of the packets per latency.
+ *
+ * @param latencies The number of packets received per latency (ms).
+ * @param fraction The fraction of the packets received with a lower latency.
+ * @return The latency (ms).
+ */
+int getPercentile(const std::vector<long> &latencies, double fraction)
+{
+    long total = 0;
+    for (long count : latencies)
+        total += count;
+    long rank = std::ceil(fraction * total), seen = 0;
+    for (size_t latency = 0; latency < latencies.size(); latency++)
+    {
+        seen += latencies[latency];
+        if (seen >= rank && seen > 0)
+            return latency;
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets the CPU time used by a thread.
+ *
+ * @param thread The thread.
+ * @return The CPU time (s).
+ */
+double getCpuTime(std::thread &thread)
+{
+    clockid_t clock;
+    timespec time;
+    if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0 || clock_gettime(clock, &time) != 0)
+        return 0;
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ipsPath> [options]" << std::endl;
+        std::cerr << "  ipsPath: The path to the file containing the port the swarm receives on, then the IP addresses and ports the bots send to (games, a relay, or the swarm itself)." << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --bots=<n>: The number of bots (default: 100)." << std::endl;
+        std::cerr << "  --first-id=<n>: The id of the first bot in the packets, the others following it (default: 1)." << std::endl;
+        std::cerr << "  --path=<path>: The path walked by all the bots in a loop, each from a different step: an action (forward, backward, left, right or wait) and a duration in seconds per line (default: a random walk)." << std::endl;
+        std::cerr << "  --ramp=<s>: The time over which the bots join one after the other, to find the load that saturates the receiver (default: 0, all at once)." << std::endl;
+        std::cerr << "  --duration=<s>: The time the swarm runs (default: 10)." << std::endl;
+        std::cerr << "  --fps=<n>: The number of moves of the bots per second (default: 60)." << std::endl;
+        std::cerr << "  --send-rate=<Hz>, --min-move=<distance>, --min-turn=<radians>, --keyframe-interval=<ms>: When the bots send their positions, as in the game (defaults: 20, 0.01, 0.01, 1000)." << std::endl;
+        std::cerr << "  --report=<s>: The time between two reports (default: 1)." << std::endl;
+        std::cerr << "Example: " << argv[0] << " swarm.txt --bots=500 --ramp=20 --duration=25" << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 2, {"bots", "first-id", "path", "ramp",
+                                                                              "duration", "fps", "send-rate",
+                                                                              "min-move", "min-turn",
+                                                                              "keyframe-interval", "report"});
+    NetworkData data = parseIPs(argv[1]);
+    int nbBots = options.count("bots") ? std::stoi(options["bots"]) : 100;
+    int firstId = options.count("first-id") ? std::stoi(options["first-id"]) : 1;
+    if (nbBots <= 0 || firstId < 0 || firstId + nbBots > PeerTable::maxIds)
+        throw std::invalid_argument("The ids of the bots are out of range");
+    std::vector<PathStep> path;
+    if (options.count("path"))
+        path = readPath(options["path"]);
+    double ramp = options.count("ramp") ? std::stod(options["ramp"]) : 0;
+    double duration = options.count("duration") ? std::stod(options["duration"]) : 10;
+    double fps = options.count("fps") ? std::stod(options["fps"]) : 60;
+    double sendRate = options.count("send-rate") ? std::stod(options["send-rate"]) : 20;
+    double minMove = options.count("min-move") ? std::stod(options["min-move"]) : 0.01;
+    double minTurn = options.count("min-turn") ? std::stod(options["min-turn"]) : 0.01;
+    int keyframeInterval = options.count("keyframe-interval") ? std::stoi(options["keyframe-interval"]) : 1000;
+    double report = options.count("report") ? std::stod(options["report"]) : 1;
+
+    // the bots start on random empty tiles of the map, facing random directions
+    Map map = Map::generateMap(0);
+    srand(42);
+    std::vector<Bot> bots;
+    for (int i = 0; i < nbBots; i++)
+    {
+        int x, y;
+        do
+        {
+            x = rand() % map.getWidth();
+            y = rand() % map.getHeight();
+        } while (map.hasWall(x, y));
+        double angle = 2 * M_PI * rand() / RAND_MAX;
+        Vector<double> direction(std::cos(angle), std::sin(angle));
+        Vector<double> camera(-0.66 * direction.y(), 0.66 * direction.x());
+        Player player({x + 0.5, y + 0.5}, direction, camera, 5, 3, map);
+        Bot bot = {player, SendScheduler(sendRate, minMove, minTurn, keyframeInterval), firstId + i, 0, 0, {0, 0, 0}, 0};
+        // the bots walking the same path start from different steps
+        if (!path.empty())
+        {
+            bot.step = i % path.size();
+            bot.current = path[bot.step];
+            bot.remaining = bot.current.seconds * rand() / RAND_MAX;
+        }
+        bots.push_back(bot);
+    }
+
+    UDPReceiver receiver(data.listeningPort, 1024);
+    UDPFanoutSender sender(data.ipPorts);
+    PeerTable peers(nbBots, -1);
+    PlayerSnapshots snapshots(nbBots);
+    // the receiving thread counts the packets on its own, the reports reading its counters
+    PositionReceiver positions(peers, snapshots, true);
+    PositionReceiveStats lastStats = positions.getStats();
+    long sent = 0, lastSent = 0;
+    std::atomic<bool> isRunning(true);
+    std::thread receiveThread(&PositionReceiver::run<UDPReceiver>, &positions, &receiver, &isRunning);
+
+    std::cout << "Running " << nbBots << " bots sending to " << data.ipPorts.size() << " destinations, receiving on port "
+              << data.listeningPort << std::endl;
+    auto start = std::chrono::steady_clock::now(), nextFrame = start;
+    auto frameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / fps));
+    double dt = 1 / fps, lastReport = 0, lastCpu = 0;
+    for (;;)
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= duration)
+            break;
+        int joined = ramp > 0 ? std::min(nbBots, int(std::ceil(nbBots * elapsed / ramp))) : nbBots;
+
+        uint32_t now = PositionPacket::now();
+        for (int i = 0; i < joined; i++)
+        {
+            Bot &bot = bots[i];
+            bot.remaining -= dt;
+            if (bot.remaining <= 0)
+            {
+                bot.step = path.empty() ? 0 : (bot.step + 1) % path.size();
+                bot.current = path.empty() ? randomStep() : path[bot.step];
+                bot.remaining = bot.current.seconds;
+            }
+            // a bot offers its new state to its scheduler every frame it moves, as the game does
+            Player &player = bot.player;
+            double oldX = player.posX(), oldY = player.posY(), oldDirX = player.dirX();
+            player.move(bot.current.move * dt);
+            player.turn(bot.current.turn * dt);
+            if (player.posX() != oldX || player.posY() != oldY || player.dirX() != oldDirX || bot.sequence == 0)
+                bot.scheduler.update({bot.id, player.posX(), player.posY(), std::atan2(player.dirY(), player.dirX())}, now);
+
+            EntityUpdate state;
+            while (bot.scheduler.poll(now, state))
+            {
+                PositionPacket packet(bot.id, bot.sequence++, now);
+                packet.add(state);
+                sender.send(packet);
+                sent++;
+            }
+        }
+
+        if (elapsed - lastReport >= report)
+        {
+            PositionReceiveStats stats = positions.getStats(), current = subtractStats(stats, lastStats);
+            double seconds = elapsed - lastReport, cpu = getCpuTime(receiveThread);
+            std::cout << elapsed << " s, " << joined << " bots: " << (sent - lastSent) / seconds << " packets/s sent, "
+                      << current.packets / seconds << " packets/s received (" << current.updates / seconds
+                      << " updates/s), latency " << getPercentile(current.latencies, 0.5) << " ms (99th percentile: "
+                      << getPercentile(current.latencies, 0.99) << " ms), " << current.lost << " packets lost, receiving thread "
+                      << 100 * (cpu - lastCpu) / seconds << "% busy" << std::endl;
+            lastStats = stats;
+            lastSent = sent;
+            lastReport = elapsed;
+            lastCpu = cpu;
+        }
+
+        // a late frame does not make the next ones closer together
+        nextFrame = std::max(nextFrame + frameTime, std::chrono::steady_clock::now());
+        std::this_thread::sleep_until(nextFrame);
+    }
+
+    isRunning = false;
+    receiveThread.join();
+    PositionReceiveStats total = positions.getStats();
+    std::cout << "Total: " << sent << " packets sent, " << total.packets << " received (" << total.updates
+              << " updates), latency " << getPercentile(total.latencies, 0.5) << " ms (99th percentile: "
+              << getPercentile(total.latencies, 0.99) << " ms), " << total.lost << " packets lost" << std::endl;
+    std::cout << sender.getStats();
+    std::cout << peers.getStats();
+    const ReceiveStats &receiveStats = receiver.getStats();
+    std::cout << "Receiver: " << double(receiveStats.packets) / std::max(receiveStats.wakeups, 1L) << " packets per wake-up, "
+              << receiveStats.truncated << " truncated" << std::endl;
+    return 0;
+}